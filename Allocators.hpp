@@ -0,0 +1,242 @@
+#pragma once
+// allocation layer for the frame loop: a bump arena for data that only lives until the end of the frame,
+// fixed-size pools for scene objects, and process-wide allocation counters so the frame stats show
+// whether the steady-state loop still touches the heap. the counters only move in programs that
+// replace the global operator new: define GAME_ALLOCATION_COUNTING_IMPLEMENTATION in exactly one
+// translation unit before including this header.
+
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <span>
+#include <atomic>
+#include <new>
+#include <iostream>
+#include <algorithm>
+#include <type_traits>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+
+namespace Game {
+#pragma region AllocationCounters
+    // totals since startup from every thread; FrameStatsLog turns them into per-frame numbers
+    struct AllocationCounters {
+        std::atomic<uint64_t> allocations{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+        std::atomic<uint64_t> frees{ 0 };
+    };
+
+    inline AllocationCounters allocationCounters;
+
+    namespace Allocation {
+        inline void* countedAllocate(std::size_t size, std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            allocationCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+            allocationCounters.bytes.fetch_add(size, std::memory_order_relaxed);
+            if (size == 0) size = 1;
+            if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) return std::malloc(size);
+#ifdef _MSC_VER
+            return _aligned_malloc(size, alignment);
+#else
+            return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+        }
+
+        inline void countedFree(void* pointer, std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            if (!pointer) return;
+            allocationCounters.frees.fetch_add(1, std::memory_order_relaxed);
+#ifdef _MSC_VER
+            if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                _aligned_free(pointer);
+                return;
+            }
+#endif
+            (void)alignment;
+            std::free(pointer);
+        }
+    }
+#pragma endregion
+
+#pragma region FrameArena
+    // bump allocator for transient per-frame data. allocating moves a pointer, deallocating does nothing
+    // and reset() at the end of the frame drops everything at once. a frame that needs more than the block
+    // holds gets the rest from the heap, and the next reset grows the block to that frame's peak, so the
+    // steady state never allocates. works as a std::pmr resource; containers on it must be gone (or at
+    // least never touched again) before reset. one thread at a time.
+    class FrameArena : public std::pmr::memory_resource {
+    public:
+        explicit FrameArena(size_t capacity = size_t(1) << 20) {
+            grow(capacity);
+        }
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        ~FrameArena() override {
+            releaseOverflow();
+        }
+
+        // frees this frame's allocations; grows the block first if the frame ran past it
+        void reset() {
+            lastFrameBytes = used();
+            peakBytes = std::max(peakBytes, lastFrameBytes);
+            if (!overflow.empty()) {
+                releaseOverflow();
+                grow(peakBytes + peakBytes / 4);
+            }
+            offset = 0;
+        }
+
+        // uninitialized storage for count trivially destructible objects, gone after reset
+        template<typename T>
+        std::span<T> allocateArray(size_t count) {
+            static_assert(std::is_trivially_destructible_v<T>, "the arena never runs destructors");
+            return { static_cast<T*>(allocate(count * sizeof(T), alignof(T))), count };
+        }
+
+        size_t used() const { return offset + overflowBytes; }
+        size_t capacity() const { return blockSize; }
+        size_t lastFrameUsed() const { return lastFrameBytes; }
+
+    private:
+        struct OverflowBlock {
+            void* pointer;
+            size_t bytes;
+            size_t alignment;
+        };
+
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+            uintptr_t start = (base + offset + alignment - 1) & ~uintptr_t(alignment - 1);
+            if (start + bytes <= base + blockSize) {
+                offset = start + bytes - base;
+                return reinterpret_cast<void*>(start);
+            }
+
+            void* pointer = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            overflow.push_back({ pointer, bytes, alignment });
+            overflowBytes += bytes;
+            return pointer;
+        }
+
+        void do_deallocate(void*, size_t, size_t) override {
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        void grow(size_t bytes) {
+            if (bytes <= blockSize) return;
+            block = std::make_unique<std::byte[]>(bytes);
+            blockSize = bytes;
+        }
+
+        void releaseOverflow() {
+            for (const OverflowBlock& allocation : overflow) {
+                std::pmr::new_delete_resource()->deallocate(allocation.pointer, allocation.bytes, allocation.alignment);
+            }
+            overflow.clear();
+            overflowBytes = 0;
+        }
+
+        std::unique_ptr<std::byte[]> block;
+        size_t blockSize = 0;
+        size_t offset = 0;
+        std::vector<OverflowBlock> overflow;
+        size_t overflowBytes = 0;
+        size_t lastFrameBytes = 0, peakBytes = 0;
+    };
+#pragma endregion
+
+#pragma region ObjectPool
+    // fixed-size slots for objects of one type, allocated chunkSize at a time and never moved, so pointers
+    // stay valid. destroyed slots go on a free list and are handed out again first; once the pool has
+    // grown to the scene's size, creating and destroying objects never touches the heap.
+    template<typename T, size_t chunkSize = 256>
+    class ObjectPool {
+    public:
+        ObjectPool() = default;
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        // objects still alive are not destroyed, the pool doesn't know which slots hold one
+        ~ObjectPool() {
+            if (live) std::cerr << "ObjectPool destroyed with " << live << " live objects" << std::endl;
+        }
+
+        template<typename... Args>
+        T* create(Args&&... args) {
+            if (!freeList) addChunk();
+            Slot* slot = freeList;
+            freeList = slot->next;
+            ++live;
+            return ::new (static_cast<void*>(slot->storage)) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(T* object) {
+            if (!object) return;
+            object->~T();
+            Slot* slot = reinterpret_cast<Slot*>(object);
+            slot->next = freeList;
+            freeList = slot;
+            --live;
+        }
+
+        void reserve(size_t count) {
+            while (capacity() < count) addChunk();
+        }
+
+        size_t size() const { return live; }
+        size_t capacity() const { return chunks.size() * chunkSize; }
+
+    private:
+        union Slot {
+            Slot* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        // linked back to front, so slots are handed out in address order
+        void addChunk() {
+            chunks.push_back(std::make_unique<Slot[]>(chunkSize));
+            Slot* chunk = chunks.back().get();
+            for (size_t i = chunkSize; i-- > 0;) {
+                chunk[i].next = freeList;
+                freeList = &chunk[i];
+            }
+        }
+
+        std::vector<std::unique_ptr<Slot[]>> chunks;
+        Slot* freeList = nullptr;
+        size_t live = 0;
+    };
+#pragma endregion
+}
+
+#ifdef GAME_ALLOCATION_COUNTING_IMPLEMENTATION
+// every global new/delete goes through the counters. the nothrow forms call these by default.
+void* operator new(std::size_t size) {
+    if (void* pointer = Game::Allocation::countedAllocate(size)) return pointer;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    if (void* pointer = Game::Allocation::countedAllocate(size)) return pointer;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* pointer = Game::Allocation::countedAllocate(size, static_cast<std::size_t>(alignment))) return pointer;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* pointer = Game::Allocation::countedAllocate(size, static_cast<std::size_t>(alignment))) return pointer;
+    throw std::bad_alloc();
+}
+void operator delete(void* pointer) noexcept { Game::Allocation::countedFree(pointer); }
+void operator delete[](void* pointer) noexcept { Game::Allocation::countedFree(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { Game::Allocation::countedFree(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { Game::Allocation::countedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment) noexcept { Game::Allocation::countedFree(pointer, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { Game::Allocation::countedFree(pointer, static_cast<std::size_t>(alignment)); }
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept { Game::Allocation::countedFree(pointer, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept { Game::Allocation::countedFree(pointer, static_cast<std::size_t>(alignment)); }
+#endif
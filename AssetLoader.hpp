@@ -0,0 +1,150 @@
+#pragma once
+// asynchronous asset loading: files are decoded on a worker pool, GL objects are created
+// on the context thread in a bounded per-frame step (pumpUploads).
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <functional>
+#include <filesystem>
+#include <print>
+
+#include "ThreadPool.hpp"
+#include "MeshLoader.hpp"
+#include "Profiler.hpp"
+
+namespace Game {
+    struct AssetLoadTimings {
+        double queuedMs = 0.0;  // waiting for a free worker
+        double decodeMs = 0.0;  // cache lookup / import on the worker
+        double uploadMs = 0.0;  // GL work on the context thread
+        double totalMs = 0.0;   // request to ready, including time spent waiting for pumpUploads
+        bool cacheHit = false;
+    };
+
+    class MeshRequest {
+    public:
+        enum class State { Queued, Decoding, Decoded, Ready, Failed };
+
+        const std::string path;
+        const MeshImportOptions options;
+
+        MeshRequest(std::string path, const MeshImportOptions& options, std::function<void(MeshData&)> onUpload, std::function<void()> onFailed)
+            : path(std::move(path)), options(options), onUpload(std::move(onUpload)), onFailed(std::move(onFailed)), requested(std::chrono::steady_clock::now()) {
+        }
+
+        State state() const { return currentState.load(std::memory_order_acquire); }
+        bool done() const { State s = state(); return s == State::Ready || s == State::Failed; }
+        bool ready() const { return state() == State::Ready; }
+        bool failed() const { return state() == State::Failed; }
+
+        // only meaningful once done()
+        const AssetLoadTimings& timings() const { return loadTimings; }
+
+    private:
+        friend class AssetLoader;
+        using Clock = std::chrono::steady_clock;
+
+        static double msBetween(Clock::time_point a, Clock::time_point b) {
+            return std::chrono::duration<double, std::milli>(b - a).count();
+        }
+
+        std::atomic<State> currentState{ State::Queued };
+        std::function<void(MeshData&)> onUpload;
+        std::function<void()> onFailed;
+        MeshData data;
+        AssetLoadTimings loadTimings;
+        Clock::time_point requested;
+    };
+
+    using MeshHandle = std::shared_ptr<MeshRequest>;
+
+    class AssetLoader {
+    public:
+        bool reportTimings = true; // print a line per asset once it is uploaded
+
+        explicit AssetLoader(size_t threadCount = ThreadPool::defaultThreadCount()) : pool(threadCount) {
+        }
+
+        // onUpload runs on the context thread inside pumpUploads, with the decoded arrays ready to go to the GPU.
+        // onFailed runs there instead if the file could not be loaded.
+        MeshHandle loadMesh(const std::string& path, std::function<void(MeshData&)> onUpload, std::function<void()> onFailed = {}, const MeshImportOptions& options = {}) {
+            MeshHandle request = std::make_shared<MeshRequest>(path, options, std::move(onUpload), std::move(onFailed));
+            pending.fetch_add(1, std::memory_order_relaxed);
+
+            pool.enqueue([this, request] {
+                GAME_PROFILE_ZONE("MeshDecode");
+                auto start = MeshRequest::Clock::now();
+                request->loadTimings.queuedMs = MeshRequest::msBetween(request->requested, start);
+                request->currentState.store(MeshRequest::State::Decoding, std::memory_order_release);
+
+                bool ok = loadMeshData(request->path, request->data, request->options);
+                request->loadTimings.decodeMs = MeshRequest::msBetween(start, MeshRequest::Clock::now());
+                request->loadTimings.cacheHit = request->data.fromCache;
+
+                std::lock_guard<std::mutex> lock(decodedMutex);
+                request->currentState.store(ok ? MeshRequest::State::Decoded : MeshRequest::State::Failed, std::memory_order_release);
+                decoded.push_back(request);
+            });
+
+            return request;
+        }
+
+        // call once per frame on the context thread; stops once budgetMs of upload work is spent.
+        // at least one asset is uploaded per call so big meshes can't stall the queue forever.
+        size_t pumpUploads(double budgetMs = 2.0) {
+            auto start = MeshRequest::Clock::now();
+            size_t uploaded = 0;
+
+            for (;;) {
+                MeshHandle request;
+                {
+                    std::lock_guard<std::mutex> lock(decodedMutex);
+                    if (decoded.empty()) break;
+                    request = std::move(decoded.front());
+                    decoded.pop_front();
+                }
+
+                if (request->state() == MeshRequest::State::Decoded) {
+                    auto uploadStart = MeshRequest::Clock::now();
+                    if (request->onUpload) request->onUpload(request->data);
+                    request->data.release();
+
+                    auto uploadEnd = MeshRequest::Clock::now();
+                    request->loadTimings.uploadMs = MeshRequest::msBetween(uploadStart, uploadEnd);
+                    request->loadTimings.totalMs = MeshRequest::msBetween(request->requested, uploadEnd);
+                    request->currentState.store(MeshRequest::State::Ready, std::memory_order_release);
+                    ++uploaded;
+
+                    if (reportTimings) {
+                        const AssetLoadTimings& t = request->loadTimings;
+                        std::println("Loaded {} ({}): queued {:.2f} ms, decode {:.2f} ms, upload {:.2f} ms, total {:.2f} ms",
+                            std::filesystem::path(request->path).filename().string(), t.cacheHit ? "cache" : "import",
+                            t.queuedMs, t.decodeMs, t.uploadMs, t.totalMs);
+                    }
+                }
+                else {
+                    request->loadTimings.totalMs = MeshRequest::msBetween(request->requested, MeshRequest::Clock::now());
+                    std::cerr << "Failed to load mesh: " << request->path << std::endl;
+                    if (request->onFailed) request->onFailed();
+                }
+                pending.fetch_sub(1, std::memory_order_relaxed);
+
+                if (MeshRequest::msBetween(start, MeshRequest::Clock::now()) >= budgetMs) break;
+            }
+            return uploaded;
+        }
+
+        // number of requests that have not been through pumpUploads yet
+        size_t pendingCount() const { return pending.load(std::memory_order_relaxed); }
+        bool idle() const { return pendingCount() == 0; }
+
+    private:
+        std::mutex decodedMutex;
+        std::deque<MeshHandle> decoded;
+        std::atomic<size_t> pending{ 0 };
+        ThreadPool pool; // declared last so workers are joined before the queue goes away
+    };
+}
@@ -0,0 +1,88 @@
+#pragma once
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <cstdint>
+#include <span>
+#include <algorithm>
+
+#include "Bounds.hpp"
+
+namespace Game {
+#pragma region BaseProperties
+	struct Transform {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::quat rotation = glm::quat(glm::vec3(0.0f)); // from Euler or direct quaternion
+        glm::vec3 scale = glm::vec3(1.0f);
+	};
+	struct Vertex {
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texCoords;
+	};
+#pragma endregion
+
+#pragma region MeshLayout
+    constexpr uint32_t maxLodLevels = 4; // including the full resolution level
+
+    struct LodRange {
+        uint32_t indexOffset = 0, indexCount = 0;
+    };
+
+    // one aiMesh worth of triangles inside the shared vertex/index arrays of a model.
+    // indices are already rebased onto the shared vertex array.
+    struct SubMesh {
+        uint32_t indexOffset = 0, indexCount = 0;
+        uint32_t vertexOffset = 0, vertexCount = 0;
+        uint32_t materialIndex = 0;
+
+        // in the space of the node that references the sub-mesh, filled in by the loader
+        AABB bounds;
+        BoundingSphere sphere;
+
+        // simplified versions of the same triangles, later in the same index buffer. level 0 is the
+        // range above, lods[i] holds level i + 1.
+        uint32_t lodLevels = 1;
+        LodRange lods[maxLodLevels - 1];
+
+        // clusters of the full resolution level, a range in the model's meshlet list
+        uint32_t firstMeshlet = 0, meshletCount = 0;
+
+        LodRange lodRange(uint32_t level) const {
+            level = std::min(level, lodLevels - 1);
+            return level == 0 ? LodRange{ indexOffset, indexCount } : lods[level - 1];
+        }
+    };
+
+    // a contiguous run of a sub-mesh's triangles with its bounds and normal cone (node space).
+    // coneCutoff is the sine of the cone's half angle widened by 90 degrees; 1 means never back-facing.
+    struct Meshlet {
+        uint32_t indexOffset = 0, indexCount = 0;
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+        glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        float coneCutoff = 1.0f;
+    };
+
+    // a node of the model's hierarchy as it came out of Assimp. nodes are stored parents first,
+    // sorted by depth, and reference their sub-meshes through a range in the node-mesh list.
+    struct MeshNode {
+        glm::mat4 local = glm::mat4(1.0f);
+        int32_t parent = -1;
+        uint32_t firstMesh = 0, meshCount = 0;
+        uint32_t depth = 0;
+    };
+
+    // read-only view over a model's arrays, either owned by a MeshData or mapped from the cache
+    struct MeshView {
+        std::span<const Vertex> vertices;
+        std::span<const unsigned int> indices;
+        std::span<const SubMesh> subMeshes;
+        std::span<const MeshNode> nodes;
+        std::span<const uint32_t> nodeMeshes; // sub-mesh indices, ranges referenced by MeshNode
+        std::span<const Meshlet> meshlets;    // ranges referenced by SubMesh
+        std::span<const char> materialPaths;  // base color texture per material as written in the model, each null-terminated ("" for none)
+    };
+#pragma endregion
+}
@@ -0,0 +1,293 @@
+#pragma once
+// headless benchmark mode: renders a procedural scene into an offscreen framebuffer along a scripted
+// camera path for a fixed number of frames, without vsync or input, then reports frame time statistics
+// and optional image hashes. everything that moves is a function of the frame index, so two runs of
+// the same build on the same driver render exactly the same frames.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <format>
+#include <print>
+#include <iostream>
+#include <span>
+#include <cstdint>
+
+namespace Game::Benchmark {
+    struct Options {
+        bool enabled = false;        // --benchmark
+        uint32_t frames = 600;       // measured frames
+        uint32_t warmupFrames = 60;  // rendered first and not measured (uploads, shader cache, driver warmup)
+        int width = 1280, height = 720;
+        uint32_t gridSize = 32;      // the scene is gridSize x gridSize objects
+        uint32_t hashEvery = 0;      // hash the image every n measured frames, 0 = never
+        std::string csvPath;         // per-frame stats (FrameStatsLog) if not empty
+
+        static void printUsage() {
+            std::println("usage: BASIC_GAME [--benchmark] [--frames N] [--warmup N] [--size WxH] [--grid N] [--hash-every N] [--csv PATH]");
+        }
+
+        // false on anything it doesn't understand
+        bool parse(int argc, char** argv) {
+            for (int i = 1; i < argc; ++i) {
+                std::string_view arg = argv[i];
+                auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+                bool ok = true;
+
+                if (arg == "--benchmark" || arg == "--headless") enabled = true;
+                else if (arg == "--frames") ok = parseNumber(next(), frames);
+                else if (arg == "--warmup") ok = parseNumber(next(), warmupFrames);
+                else if (arg == "--grid") ok = parseNumber(next(), gridSize);
+                else if (arg == "--hash-every") ok = parseNumber(next(), hashEvery);
+                else if (arg == "--size") ok = parseSize(next());
+                else if (arg == "--csv") {
+                    const char* path = next();
+                    ok = path != nullptr;
+                    if (ok) csvPath = path;
+                }
+                else ok = false;
+
+                if (!ok) {
+                    std::cerr << "Bad argument: " << arg << std::endl;
+                    printUsage();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        static bool parseNumber(const char* text, uint32_t& out) {
+            if (!text) return false;
+            std::string_view view(text);
+            auto [end, error] = std::from_chars(view.data(), view.data() + view.size(), out);
+            return error == std::errc() && end == view.data() + view.size();
+        }
+
+        bool parseSize(const char* text) {
+            if (!text) return false;
+            std::string_view view(text);
+            size_t x = view.find('x');
+            if (x == std::string_view::npos) return false;
+            uint32_t w = 0, h = 0;
+            std::string first(view.substr(0, x)), second(view.substr(x + 1));
+            if (!parseNumber(first.c_str(), w) || !parseNumber(second.c_str(), h) || w == 0 || h == 0) return false;
+            width = static_cast<int>(w);
+            height = static_cast<int>(h);
+            return true;
+        }
+    };
+
+    // fixed simulation step, so animation doesn't depend on how fast frames come out
+    constexpr float timeStep = 1.0f / 60.0f;
+
+    // slow orbit around the scene that also dips into it, so culling, LOD and occlusion all get work.
+    // sceneExtent is half the width of the object grid.
+    struct CameraPath {
+        float sceneExtent = 32.0f;
+
+        glm::vec3 position(float time) const {
+            float angle = time * 0.15f;
+            float radius = sceneExtent * (0.55f + 0.45f * std::cos(time * 0.11f));
+            float height = 2.0f + sceneExtent * 0.25f * (0.5f + 0.5f * std::sin(time * 0.23f));
+            return glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+        }
+
+        // looks a little ahead along the orbit instead of at the center, so the view sweeps over the scene
+        glm::vec3 front(float time) const {
+            glm::vec3 target = position(time + 2.0f) * 0.35f;
+            target.y = 0.0f;
+            return glm::normalize(target - position(time));
+        }
+    };
+
+#pragma region OffscreenTarget
+    // color + depth renderbuffers; what the default framebuffer would be for a window
+    class OffscreenTarget {
+    public:
+        OffscreenTarget() = default;
+        OffscreenTarget(const OffscreenTarget&) = delete;
+        OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+        ~OffscreenTarget() {
+            release();
+        }
+
+        bool create(int width, int height) {
+            release();
+            this->width = width;
+            this->height = height;
+
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+            glGenRenderbuffers(1, &color);
+            glBindRenderbuffer(GL_RENDERBUFFER, color);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+
+            glGenRenderbuffers(1, &depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, depth);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cerr << "Offscreen framebuffer incomplete" << std::endl;
+                release();
+                return false;
+            }
+            glViewport(0, 0, width, height);
+            return true;
+        }
+
+        // call before the context goes away
+        void release() {
+            if (framebuffer) {
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glDeleteFramebuffers(1, &framebuffer);
+            }
+            if (color) glDeleteRenderbuffers(1, &color);
+            if (depth) glDeleteRenderbuffers(1, &depth);
+            framebuffer = color = depth = 0;
+        }
+
+        void bind() const {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        }
+
+        // RGBA8, bottom row first. stalls until the frame is done, so only for the frames being hashed.
+        void readPixels(std::vector<uint8_t>& out) const {
+            out.resize(size_t(width) * height * 4);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, out.data());
+        }
+
+        bool valid() const { return framebuffer != 0; }
+
+    private:
+        GLuint framebuffer = 0, color = 0, depth = 0;
+        int width = 0, height = 0;
+    };
+#pragma endregion
+
+    // FNV-1a; only comparable between runs on the same driver, rasterization differs between GPUs
+    inline uint64_t hashPixels(std::span<const uint8_t> pixels) {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint8_t byte : pixels) {
+            hash ^= byte;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // with no swap to throttle it, the CPU could queue up any number of frames; keep at most
+    // framesInFlight in the pipeline like a swap chain would
+    class FramePacer {
+    public:
+        static constexpr int framesInFlight = 2;
+
+        ~FramePacer() {
+            release();
+        }
+
+        // call at the end of a frame
+        void endFrame() {
+            GLsync& slot = fences[next];
+            if (slot) {
+                glClientWaitSync(slot, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+                glDeleteSync(slot);
+            }
+            slot = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            next = (next + 1) % framesInFlight;
+        }
+
+        void release() {
+            for (GLsync& fence : fences) {
+                if (fence) glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+
+    private:
+        GLsync fences[framesInFlight] = {};
+        int next = 0;
+    };
+
+    struct Summary {
+        double min = 0.0, avg = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+    };
+
+    inline Summary summarize(std::vector<double> samples) {
+        Summary summary;
+        if (samples.empty()) return summary;
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&](double p) { return samples[std::min(samples.size() - 1, size_t(p * double(samples.size())))]; };
+
+        double sum = 0.0;
+        for (double sample : samples) sum += sample;
+        summary.min = samples.front();
+        summary.avg = sum / double(samples.size());
+        summary.p50 = percentile(0.50);
+        summary.p95 = percentile(0.95);
+        summary.p99 = percentile(0.99);
+        summary.max = samples.back();
+        return summary;
+    }
+
+    // what gets measured per frame, and the final report
+    class Recorder {
+    public:
+        // gpuMs <= 0 on frames without a new GPU result, so a late result is counted once
+        void addFrame(double frameMs, double cpuMs, double gpuMs, double meshletRejectedPercent, uint32_t draws, uint64_t triangles, uint64_t allocations = 0) {
+            frameTimes.push_back(frameMs);
+            cpuTimes.push_back(cpuMs);
+            if (gpuMs > 0.0) gpuTimes.push_back(gpuMs);
+            meshletRejected.push_back(meshletRejectedPercent);
+            drawTotal += draws;
+            triangleTotal += triangles;
+            allocationTotal += allocations;
+            allocationMax = std::max(allocationMax, allocations);
+        }
+
+        void addHash(uint32_t frame, uint64_t hash) {
+            hashes.push_back({ frame, hash });
+        }
+
+        void printReport(const Options& options, double wallSeconds) const {
+            size_t frames = frameTimes.size();
+            if (frames == 0) return;
+
+            std::println("benchmark: {} frames at {}x{}, {} objects, {:.2f} s, {:.1f} fps",
+                frames, options.width, options.height, options.gridSize * options.gridSize, wallSeconds, double(frames) / wallSeconds);
+            std::println("{:<10} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9}   (ms)", "", "min", "avg", "p50", "p95", "p99", "max");
+            printRow("frame", summarize(frameTimes));
+            printRow("cpu", summarize(cpuTimes));
+            if (!gpuTimes.empty()) printRow("gpu", summarize(gpuTimes));
+
+            double rejected = 0.0;
+            for (double percent : meshletRejected) rejected += percent;
+            std::println("per frame: {:.1f} draws, {:.0f} triangles, meshlet triangles rejected {:.1f}%",
+                double(drawTotal) / double(frames), double(triangleTotal) / double(frames), rejected / double(frames));
+            std::println("heap allocations per frame: {:.1f} avg, {} max", double(allocationTotal) / double(frames), allocationMax);
+
+            for (const auto& [frame, hash] : hashes) std::println("image hash frame {}: {:016x}", frame, hash);
+        }
+
+    private:
+        static void printRow(std::string_view name, const Summary& s) {
+            std::println("{:<10} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f}", name, s.min, s.avg, s.p50, s.p95, s.p99, s.max);
+        }
+
+        std::vector<double> frameTimes, cpuTimes, gpuTimes, meshletRejected;
+        std::vector<std::pair<uint32_t, uint64_t>> hashes;
+        uint64_t drawTotal = 0, triangleTotal = 0;
+        uint64_t allocationTotal = 0, allocationMax = 0;
+    };
+}
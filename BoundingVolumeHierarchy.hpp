@@ -0,0 +1,284 @@
+#pragma once
+// dynamic AABB tree for culling. leaves store a "fat" box (the object's bounds plus a margin), so small
+// movements don't touch the tree at all; larger ones refit the path to the root, and only objects that
+// jumped somewhere else entirely get reinserted. insertion picks the cheapest sibling by surface area
+// and AVL-style rotations keep the tree balanced.
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "Bounds.hpp"
+
+namespace Game {
+    template<typename Payload>
+    class BoundingVolumeHierarchy {
+    public:
+        using ProxyId = int32_t;
+        static constexpr ProxyId nullNode = -1;
+
+        struct CullStats {
+            uint32_t nodesTested = 0;
+            uint32_t visible = 0;
+            uint32_t culled = 0;
+        };
+
+        // leaf boxes grow by this fraction of their size (plus a small absolute amount) on every side
+        float marginScale = 0.1f;
+        float marginMin = 0.05f;
+
+        ProxyId insert(const AABB& bounds, Payload payload) {
+            ProxyId leaf = allocateNode();
+            nodes[leaf].bounds = fatten(bounds);
+            nodes[leaf].payload = payload;
+            nodes[leaf].height = 0;
+            insertLeaf(leaf);
+            ++proxyCount;
+            return leaf;
+        }
+
+        void remove(ProxyId proxy) {
+            removeLeaf(proxy);
+            freeNode(proxy);
+            --proxyCount;
+        }
+
+        // returns true if the tree had to change
+        bool move(ProxyId proxy, const AABB& bounds) {
+            Node& leaf = nodes[proxy];
+            if (leaf.bounds.contains(bounds)) return false;
+
+            AABB fat = fatten(bounds);
+            if (!fat.overlaps(leaf.bounds)) {
+                // teleported: the old spot in the tree is meaningless now
+                removeLeaf(proxy);
+                nodes[proxy].bounds = fat;
+                insertLeaf(proxy);
+                return true;
+            }
+
+            // moved a bit beyond the margin: refit ancestors until one already covers the change
+            leaf.bounds = fat;
+            for (ProxyId index = leaf.parent; index != nullNode; index = nodes[index].parent) {
+                AABB refit = AABB::merge(nodes[nodes[index].child1].bounds, nodes[nodes[index].child2].bounds);
+                if (refit.min == nodes[index].bounds.min && refit.max == nodes[index].bounds.max) break;
+                nodes[index].bounds = refit;
+            }
+            return true;
+        }
+
+        Payload payload(ProxyId proxy) const { return nodes[proxy].payload; }
+        const AABB& fatBounds(ProxyId proxy) const { return nodes[proxy].bounds; }
+        size_t size() const { return proxyCount; }
+        int height() const { return root == nullNode ? 0 : nodes[root].height; }
+
+        // calls onVisible(payload) for every leaf whose fat box touches the frustum. subtrees that are
+        // completely inside are taken without testing their children.
+        template<typename Callback>
+        void query(const Frustum& frustum, Callback&& onVisible, CullStats* stats = nullptr) const {
+            CullStats local;
+            if (root != nullNode) {
+                stack.clear();
+                stack.push_back({ root, false });
+                while (!stack.empty()) {
+                    auto [index, inside] = stack.back();
+                    stack.pop_back();
+                    const Node& node = nodes[index];
+
+                    if (!inside) {
+                        ++local.nodesTested;
+                        Frustum::Result result = frustum.classify(node.bounds);
+                        if (result == Frustum::Outside) continue;
+                        inside = result == Frustum::Inside;
+                    }
+
+                    if (node.isLeaf()) {
+                        ++local.visible;
+                        onVisible(node.payload);
+                        continue;
+                    }
+                    stack.push_back({ node.child1, inside });
+                    stack.push_back({ node.child2, inside });
+                }
+            }
+            local.culled = static_cast<uint32_t>(proxyCount) - local.visible;
+            if (stats) *stats = local;
+        }
+
+    private:
+        struct Node {
+            AABB bounds;
+            Payload payload{};
+            ProxyId parent = nullNode; // next free node while on the free list
+            ProxyId child1 = nullNode, child2 = nullNode;
+            int32_t height = -1;       // 0 for leaves, -1 while free
+
+            bool isLeaf() const { return child1 == nullNode; }
+        };
+
+        struct StackEntry {
+            ProxyId index;
+            bool inside;
+        };
+
+        std::vector<Node> nodes;
+        ProxyId root = nullNode;
+        ProxyId freeList = nullNode;
+        size_t proxyCount = 0;
+        mutable std::vector<StackEntry> stack; // reused between queries
+
+        AABB fatten(const AABB& bounds) const {
+            glm::vec3 margin = glm::max(bounds.extents() * 2.0f * marginScale, glm::vec3(marginMin));
+            return { bounds.min - margin, bounds.max + margin };
+        }
+
+        ProxyId allocateNode() {
+            if (freeList == nullNode) {
+                nodes.emplace_back();
+                return static_cast<ProxyId>(nodes.size() - 1);
+            }
+            ProxyId index = freeList;
+            freeList = nodes[index].parent;
+            nodes[index] = Node();
+            return index;
+        }
+
+        void freeNode(ProxyId index) {
+            nodes[index] = Node();
+            nodes[index].parent = freeList;
+            freeList = index;
+        }
+
+        void insertLeaf(ProxyId leaf) {
+            if (root == nullNode) {
+                root = leaf;
+                nodes[root].parent = nullNode;
+                return;
+            }
+
+            // walk down towards the sibling that increases the total surface area the least
+            const AABB leafBounds = nodes[leaf].bounds;
+            ProxyId index = root;
+            while (!nodes[index].isLeaf()) {
+                const Node& node = nodes[index];
+                float area = node.bounds.surfaceArea();
+                float combinedArea = AABB::merge(node.bounds, leafBounds).surfaceArea();
+
+                float cost = 2.0f * combinedArea;                  // new parent for this node and the leaf
+                float inheritance = 2.0f * (combinedArea - area);  // growth pushed onto every ancestor below
+
+                auto descendCost = [&](ProxyId child) {
+                    const Node& c = nodes[child];
+                    float merged = AABB::merge(c.bounds, leafBounds).surfaceArea();
+                    return c.isLeaf() ? merged + inheritance : merged - c.bounds.surfaceArea() + inheritance;
+                };
+                float cost1 = descendCost(node.child1);
+                float cost2 = descendCost(node.child2);
+
+                if (cost < cost1 && cost < cost2) break;
+                index = cost1 < cost2 ? node.child1 : node.child2;
+            }
+
+            ProxyId sibling = index;
+            ProxyId oldParent = nodes[sibling].parent;
+            ProxyId newParent = allocateNode();
+            nodes[newParent].parent = oldParent;
+            nodes[newParent].bounds = AABB::merge(leafBounds, nodes[sibling].bounds);
+            nodes[newParent].height = nodes[sibling].height + 1;
+            nodes[newParent].child1 = sibling;
+            nodes[newParent].child2 = leaf;
+            nodes[sibling].parent = newParent;
+            nodes[leaf].parent = newParent;
+
+            if (oldParent == nullNode) {
+                root = newParent;
+            }
+            else if (nodes[oldParent].child1 == sibling) {
+                nodes[oldParent].child1 = newParent;
+            }
+            else {
+                nodes[oldParent].child2 = newParent;
+            }
+
+            refitAncestors(nodes[leaf].parent);
+        }
+
+        void removeLeaf(ProxyId leaf) {
+            if (leaf == root) {
+                root = nullNode;
+                return;
+            }
+
+            ProxyId parent = nodes[leaf].parent;
+            ProxyId grandParent = nodes[parent].parent;
+            ProxyId sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+            if (grandParent == nullNode) {
+                root = sibling;
+                nodes[sibling].parent = nullNode;
+                freeNode(parent);
+                return;
+            }
+
+            // the parent goes away, the sibling takes its place
+            if (nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+            else nodes[grandParent].child2 = sibling;
+            nodes[sibling].parent = grandParent;
+            freeNode(parent);
+
+            refitAncestors(grandParent);
+        }
+
+        void refitAncestors(ProxyId index) {
+            while (index != nullNode) {
+                index = balance(index);
+                Node& node = nodes[index];
+                node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+                node.bounds = AABB::merge(nodes[node.child1].bounds, nodes[node.child2].bounds);
+                index = node.parent;
+            }
+        }
+
+        // if one side of a is more than one level deeper than the other, rotate its taller child up.
+        // returns the index now sitting where a was.
+        ProxyId balance(ProxyId a) {
+            if (nodes[a].isLeaf() || nodes[a].height < 2) return a;
+
+            ProxyId b = nodes[a].child1;
+            ProxyId c = nodes[a].child2;
+            int32_t difference = nodes[c].height - nodes[b].height;
+
+            if (difference > 1) return rotateUp(a, c, b, false);
+            if (difference < -1) return rotateUp(a, b, c, true);
+            return a;
+        }
+
+        // promotes `up` (a child of a) over a; `other` is a's remaining child
+        ProxyId rotateUp(ProxyId a, ProxyId up, ProxyId other, bool upIsChild1) {
+            ProxyId f = nodes[up].child1;
+            ProxyId g = nodes[up].child2;
+
+            // a's parent now points at up
+            nodes[up].child1 = a;
+            nodes[up].parent = nodes[a].parent;
+            nodes[a].parent = up;
+            if (nodes[up].parent == nullNode) root = up;
+            else if (nodes[nodes[up].parent].child1 == a) nodes[nodes[up].parent].child1 = up;
+            else nodes[nodes[up].parent].child2 = up;
+
+            // the taller grandchild stays under up, the shorter one moves under a
+            ProxyId keep = nodes[f].height > nodes[g].height ? f : g;
+            ProxyId give = keep == f ? g : f;
+            nodes[up].child2 = keep;
+            if (upIsChild1) nodes[a].child1 = give;
+            else nodes[a].child2 = give;
+            nodes[give].parent = a;
+
+            nodes[a].bounds = AABB::merge(nodes[other].bounds, nodes[give].bounds);
+            nodes[a].height = 1 + std::max(nodes[other].height, nodes[give].height);
+            nodes[up].bounds = AABB::merge(nodes[a].bounds, nodes[keep].bounds);
+            nodes[up].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+            return up;
+        }
+    };
+}
@@ -0,0 +1,138 @@
+#pragma once
+// bounding volumes and view frustum tests
+
+#include <glm/glm.hpp>
+#include <limits>
+#include <cmath>
+#include <span>
+#include <algorithm>
+
+namespace Game {
+    struct AABB {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+        bool valid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+        glm::vec3 center() const { return (min + max) * 0.5f; }
+        glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+        void expand(const glm::vec3& point) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        void expand(const AABB& other) {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        bool contains(const AABB& other) const {
+            return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+                   max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+        }
+
+        bool overlaps(const AABB& other) const {
+            return min.x <= other.max.x && max.x >= other.min.x &&
+                   min.y <= other.max.y && max.y >= other.min.y &&
+                   min.z <= other.max.z && max.z >= other.min.z;
+        }
+
+        float surfaceArea() const {
+            glm::vec3 d = max - min;
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        // box around this box after an affine transform (Arvo's method, no need to transform 8 corners)
+        AABB transformed(const glm::mat4& m) const {
+            if (!valid()) return *this;
+            glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+            glm::vec3 e = extents();
+            glm::vec3 r(
+                std::abs(m[0][0]) * e.x + std::abs(m[1][0]) * e.y + std::abs(m[2][0]) * e.z,
+                std::abs(m[0][1]) * e.x + std::abs(m[1][1]) * e.y + std::abs(m[2][1]) * e.z,
+                std::abs(m[0][2]) * e.x + std::abs(m[1][2]) * e.y + std::abs(m[2][2]) * e.z);
+            return { c - r, c + r };
+        }
+
+        static AABB merge(const AABB& a, const AABB& b) {
+            return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+        }
+    };
+
+    struct BoundingSphere {
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+    };
+
+    // sphere around the box center, tighter than the box's circumsphere for most meshes
+    template<typename VertexType>
+    BoundingSphere computeBoundingSphere(std::span<const VertexType> vertices, const AABB& box) {
+        BoundingSphere sphere{ box.center(), 0.0f };
+        float radiusSq = 0.0f;
+        for (const VertexType& v : vertices) {
+            glm::vec3 d = v.position - sphere.center;
+            radiusSq = std::max(radiusSq, glm::dot(d, d));
+        }
+        sphere.radius = std::sqrt(radiusSq);
+        return sphere;
+    }
+
+    template<typename VertexType>
+    AABB computeBounds(std::span<const VertexType> vertices) {
+        AABB box;
+        for (const VertexType& v : vertices) box.expand(v.position);
+        return box;
+    }
+
+    class Frustum {
+    public:
+        enum Result { Outside, Intersecting, Inside };
+
+        // planes point inwards, xyz = normal, w = distance
+        glm::vec4 planes[6];
+
+        Frustum() = default;
+
+        // Gribb/Hartmann plane extraction from a clip matrix (projection * view for world space planes)
+        explicit Frustum(const glm::mat4& clip) {
+            glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+            glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+            glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+            glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+            planes[0] = row3 + row0; // left
+            planes[1] = row3 - row0; // right
+            planes[2] = row3 + row1; // bottom
+            planes[3] = row3 - row1; // top
+            planes[4] = row3 + row2; // near
+            planes[5] = row3 - row2; // far
+
+            for (glm::vec4& plane : planes) {
+                plane /= glm::length(glm::vec3(plane));
+            }
+        }
+
+        Result classify(const AABB& box) const {
+            glm::vec3 c = box.center();
+            glm::vec3 e = box.extents();
+            Result result = Inside;
+            for (const glm::vec4& plane : planes) {
+                glm::vec3 n(plane);
+                float distance = glm::dot(n, c) + plane.w;
+                float radius = glm::dot(glm::abs(n), e);
+                if (distance < -radius) return Outside;
+                if (distance < radius) result = Intersecting;
+            }
+            return result;
+        }
+
+        bool intersects(const AABB& box) const { return classify(box) != Outside; }
+
+        bool intersects(const BoundingSphere& sphere) const {
+            for (const glm::vec4& plane : planes) {
+                if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) return false;
+            }
+            return true;
+        }
+    };
+}
@@ -0,0 +1,243 @@
+#pragma once
+// shadow copy of the GL state we touch most: program, VAO, textures per unit, buffer bindings and the
+// depth/blend/cull switches. calls that would set what is already set never reach the driver. everything
+// starts out unknown, so the first call of each kind always goes through. GL thread only, and only
+// correct as long as every bind goes through glState; call invalidate() after code that doesn't.
+
+#include <glad/glad.h>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "RenderStats.hpp"
+
+namespace Game {
+    class GLStateCache {
+    public:
+        static constexpr GLuint unknown = ~0u;
+        static constexpr GLuint maxTextureUnits = 16;
+
+        struct Stats {
+            uint64_t issued = 0;
+            uint64_t eliminated = 0;
+        };
+
+        // forget everything, the next call of each kind is issued again
+        void invalidate() {
+            program = vertexArray = elementBuffer = unknown;
+            activeUnit = unknown;
+            for (auto& unit : textures) unit.fill(unknown);
+            buffers.clear();
+            indexedBuffers.clear();
+            capabilities.clear();
+            depthMaskState = depthFuncState = unknown;
+            blendSource = blendDestination = unknown;
+        }
+
+        // true if the call was actually made
+        bool useProgram(GLuint id) {
+            if (!changed(program, id)) return false;
+            glUseProgram(id);
+            ++renderCounters.programBinds;
+            return true;
+        }
+
+        bool bindVertexArray(GLuint id) {
+            if (!changed(vertexArray, id)) return false;
+            glBindVertexArray(id);
+            elementBuffer = unknown; // the element buffer binding belongs to the VAO
+            ++renderCounters.vaoBinds;
+            return true;
+        }
+
+        bool bindBuffer(GLenum target, GLuint id) {
+            GLuint& bound = target == GL_ELEMENT_ARRAY_BUFFER ? elementBuffer : bufferSlot(target);
+            if (!changed(bound, id)) return false;
+            glBindBuffer(target, id);
+            return true;
+        }
+
+        // also changes the generic binding of target, as glBindBufferBase does; a skipped call leaves it alone
+        bool bindBufferBase(GLenum target, GLuint index, GLuint id) {
+            for (IndexedBinding& binding : indexedBuffers) {
+                if (binding.target == target && binding.index == index) {
+                    if (!changed(binding.buffer, id)) return false;
+                    glBindBufferBase(target, index, id);
+                    bufferSlot(target) = id;
+                    return true;
+                }
+            }
+            indexedBuffers.push_back({ target, index, id });
+            glBindBufferBase(target, index, id);
+            bufferSlot(target) = id;
+            ++counters.issued;
+            return true;
+        }
+
+        bool bindTexture(GLuint unit, GLenum target, GLuint id) {
+            int slot = textureTargetSlot(target);
+            if (unit >= maxTextureUnits || slot < 0) { // not tracked, always issued
+                activeTexture(unit);
+                glBindTexture(target, id);
+                ++renderCounters.textureBinds;
+                return true;
+            }
+            if (!changed(textures[unit][slot], id)) return false;
+            activeTexture(unit);
+            glBindTexture(target, id);
+            ++renderCounters.textureBinds;
+            return true;
+        }
+
+        void enable(GLenum capability) { setCapability(capability, true); }
+        void disable(GLenum capability) { setCapability(capability, false); }
+
+        void depthMask(bool write) {
+            if (!changed(depthMaskState, write ? GL_TRUE : GL_FALSE)) return;
+            glDepthMask(write ? GL_TRUE : GL_FALSE);
+        }
+
+        void depthFunc(GLenum func) {
+            if (!changed(depthFuncState, func)) return;
+            glDepthFunc(func);
+        }
+
+        void blendFunc(GLenum source, GLenum destination) {
+            if (blendSource == source && blendDestination == destination) {
+                ++counters.eliminated;
+                ++renderCounters.redundantCalls;
+                return;
+            }
+            blendSource = source;
+            blendDestination = destination;
+            glBlendFunc(source, destination);
+            ++counters.issued;
+        }
+
+        // deleting a bound object unbinds it, so the shadow copy has to let go of the name too
+        void deleteBuffer(GLuint id) {
+            if (!id) return;
+            glDeleteBuffers(1, &id);
+            if (elementBuffer == id) elementBuffer = unknown;
+            for (BufferBinding& binding : buffers) {
+                if (binding.buffer == id) binding.buffer = unknown;
+            }
+            for (IndexedBinding& binding : indexedBuffers) {
+                if (binding.buffer == id) binding.buffer = unknown;
+            }
+        }
+
+        void deleteTexture(GLuint id) {
+            if (!id) return;
+            glDeleteTextures(1, &id);
+            for (auto& unit : textures) {
+                for (GLuint& bound : unit) {
+                    if (bound == id) bound = unknown;
+                }
+            }
+        }
+
+        void deleteVertexArray(GLuint id) {
+            if (!id) return;
+            glDeleteVertexArrays(1, &id);
+            if (vertexArray == id) vertexArray = elementBuffer = unknown;
+        }
+
+        // a program deleted while current stays in use until the next glUseProgram
+        void deleteProgram(GLuint id) {
+            if (!id) return;
+            glDeleteProgram(id);
+            if (program == id) program = unknown;
+        }
+
+        GLuint currentProgram() const { return program; }
+        GLuint currentVertexArray() const { return vertexArray; }
+
+        // totals since startup; the per-frame count is renderCounters.redundantCalls
+        const Stats& stats() const { return counters; }
+
+    private:
+        struct BufferBinding {
+            GLenum target;
+            GLuint buffer;
+        };
+
+        struct IndexedBinding {
+            GLenum target;
+            GLuint index;
+            GLuint buffer;
+        };
+
+        struct CapabilityState {
+            GLenum capability;
+            GLuint enabled;
+        };
+
+        bool changed(GLuint& current, GLuint value) {
+            if (current == value) {
+                ++counters.eliminated;
+                ++renderCounters.redundantCalls;
+                return false;
+            }
+            current = value;
+            ++counters.issued;
+            return true;
+        }
+
+        GLuint& bufferSlot(GLenum target) {
+            for (BufferBinding& binding : buffers) {
+                if (binding.target == target) return binding.buffer;
+            }
+            buffers.push_back({ target, unknown });
+            return buffers.back().buffer;
+        }
+
+        void activeTexture(GLuint unit) {
+            if (!changed(activeUnit, unit)) return;
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+
+        static int textureTargetSlot(GLenum target) {
+            switch (target) {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_CUBE_MAP: return 1;
+            case GL_TEXTURE_2D_ARRAY: return 2;
+            case GL_TEXTURE_3D: return 3;
+            case GL_TEXTURE_BUFFER: return 4;
+            default: return -1;
+            }
+        }
+
+        void setCapability(GLenum capability, bool enable) {
+            GLuint value = enable ? 1u : 0u;
+            for (CapabilityState& state : capabilities) {
+                if (state.capability != capability) continue;
+                if (!changed(state.enabled, value)) return;
+                enable ? glEnable(capability) : glDisable(capability);
+                return;
+            }
+            capabilities.push_back({ capability, value });
+            ++counters.issued;
+            enable ? glEnable(capability) : glDisable(capability);
+        }
+
+        GLuint program = unknown, vertexArray = unknown, elementBuffer = unknown;
+        GLuint activeUnit = unknown;
+        std::array<std::array<GLuint, 5>, maxTextureUnits> textures = makeUnknownTextures();
+        std::vector<BufferBinding> buffers;       // generic binding per target
+        std::vector<IndexedBinding> indexedBuffers;
+        std::vector<CapabilityState> capabilities;
+        GLuint depthMaskState = unknown, depthFuncState = unknown;
+        GLuint blendSource = unknown, blendDestination = unknown;
+        Stats counters;
+
+        static std::array<std::array<GLuint, 5>, maxTextureUnits> makeUnknownTextures() {
+            std::array<std::array<GLuint, 5>, maxTextureUnits> result;
+            for (auto& unit : result) unit.fill(unknown);
+            return result;
+        }
+    };
+
+    // the one context's shadow state
+    inline GLStateCache glState;
+}
@@ -0,0 +1,351 @@
+#pragma once
+// one big vertex/index buffer pair per vertex format and index type, shared by every mesh. meshes get a
+// range of each (drawn with base vertex, their indices stay mesh relative) and all of them share one VAO,
+// so the render queue can batch different meshes into a single multi-draw.
+
+#include <glad/glad.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#include "BaseProperties.hpp"
+#include "VertexFormats.hpp"
+#include "GLState.hpp"
+
+namespace Game {
+    // attribute layout of Vertex / PackedVertex for the currently bound VAO and GL_ARRAY_BUFFER
+    inline void setupVertexAttributes(bool packed) {
+        if (packed) {
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position)); // position, 0..1 in the mesh bounds
+            glEnableVertexAttribArray(0);
+
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal)); // normal, w ignored
+            glEnableVertexAttribArray(1);
+
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords)); // uv
+            glEnableVertexAttribArray(2);
+        }
+        else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0); // position
+            glEnableVertexAttribArray(0);
+
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal)); // normal
+            glEnableVertexAttribArray(1);
+
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords)); // uv
+            glEnableVertexAttribArray(2);
+        }
+    }
+
+    // glMultiDrawElementsIndirect (and base instance in the commands) needs GL 4.3
+    inline bool supportsMultiDrawIndirect() {
+#ifdef GL_VERSION_4_3
+        return GLAD_GL_VERSION_4_3 != 0;
+#else
+        return false;
+#endif
+    }
+
+#pragma region RangeAllocator
+    // first fit over a free list of [offset, offset + size) element ranges, neighbours merge on free
+    class RangeAllocator {
+    public:
+        static constexpr uint32_t invalidOffset = ~0u;
+
+        explicit RangeAllocator(uint32_t capacity = 0) { grow(capacity); }
+
+        uint32_t allocate(uint32_t size) {
+            if (size == 0) return 0;
+            for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+                if (it->second < size) continue;
+                uint32_t offset = it->first;
+                uint32_t remaining = it->second - size;
+                freeRanges.erase(it);
+                if (remaining) freeRanges.emplace(offset + size, remaining);
+                used += size;
+                return offset;
+            }
+            return invalidOffset;
+        }
+
+        void free(uint32_t offset, uint32_t size) {
+            if (size == 0) return;
+            used -= size;
+            auto next = freeRanges.lower_bound(offset);
+            if (next != freeRanges.begin()) {
+                auto previous = std::prev(next);
+                if (previous->first + previous->second == offset) {
+                    offset = previous->first;
+                    size += previous->second;
+                    freeRanges.erase(previous);
+                }
+            }
+            if (next != freeRanges.end() && offset + size == next->first) {
+                size += next->second;
+                freeRanges.erase(next);
+            }
+            freeRanges.emplace(offset, size);
+        }
+
+        // adds [capacity, newCapacity) to the free list
+        void grow(uint32_t newCapacity) {
+            if (newCapacity <= total) return;
+            uint32_t oldCapacity = total;
+            total = newCapacity;
+            used += newCapacity - oldCapacity; // free() takes it back off
+            free(oldCapacity, newCapacity - oldCapacity);
+        }
+
+        // everything in use packed at the front, used elements already accounted for
+        void reset(uint32_t usedPrefix) {
+            freeRanges.clear();
+            used = total;
+            free(usedPrefix, total - usedPrefix);
+        }
+
+        uint32_t capacity() const { return total; }
+        uint32_t usedSize() const { return used; }
+        uint32_t freeSize() const { return total - used; }
+        uint32_t largestFree() const {
+            uint32_t largest = 0;
+            for (const auto& [offset, size] : freeRanges) largest = std::max(largest, size);
+            return largest;
+        }
+
+    private:
+        std::map<uint32_t, uint32_t> freeRanges; // offset -> size
+        uint32_t total = 0, used = 0;
+    };
+#pragma endregion
+
+#pragma region GeometryArena
+    class GeometryArena {
+    public:
+        using Handle = uint32_t;
+        static constexpr Handle invalidHandle = ~0u;
+
+        struct Stats {
+            size_t pools = 0, allocations = 0;
+            size_t usedBytes = 0, capacityBytes = 0;
+            size_t grows = 0, defragmentations = 0;
+        };
+
+        // element counts each pool starts with; pools double whenever they run out
+        explicit GeometryArena(uint32_t initialVertices = 1u << 18, uint32_t initialIndices = 3u << 18)
+            : initialVertices(initialVertices), initialIndices(initialIndices) {
+        }
+
+        GeometryArena(const GeometryArena&) = delete;
+        GeometryArena& operator=(const GeometryArena&) = delete;
+
+        ~GeometryArena() {
+            release();
+        }
+
+        // frees every pool; call before the context goes away
+        void release() {
+            for (Pool& pool : pools) {
+                glState.deleteBuffer(pool.ebo);
+                glState.deleteBuffer(pool.vbo);
+                glState.deleteVertexArray(pool.vao);
+            }
+            pools.clear();
+            allocations.clear();
+            freeHandles.clear();
+        }
+
+        // copies a mesh into the pool for its format. indices must be relative to the mesh's first vertex.
+        Handle allocate(bool packed, GLenum indexType, const void* vertexData, uint32_t vertexCount, const void* indexData, uint32_t indexCount) {
+            uint32_t poolIndex = findOrCreatePool(packed, indexType);
+            Pool& pool = pools[poolIndex];
+
+            if (!reserve(pool, pool.vertexSpace, vertexCount, true) || !reserve(pool, pool.indexSpace, indexCount, false)) {
+                std::cerr << "Geometry arena out of space for " << vertexCount << " vertices / " << indexCount << " indices" << std::endl;
+                return invalidHandle;
+            }
+            Allocation allocation{ poolIndex, pool.vertexSpace.allocate(vertexCount), vertexCount, pool.indexSpace.allocate(indexCount), indexCount, true };
+
+            glState.bindBuffer(GL_COPY_WRITE_BUFFER, pool.vbo);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(allocation.firstVertex) * pool.vertexStride, GLsizeiptr(vertexCount) * pool.vertexStride, vertexData);
+            glState.bindBuffer(GL_COPY_WRITE_BUFFER, pool.ebo);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(allocation.firstIndex) * pool.indexStride, GLsizeiptr(indexCount) * pool.indexStride, indexData);
+            renderCounters.bufferUploads += 2;
+
+            Handle handle;
+            if (!freeHandles.empty()) {
+                handle = freeHandles.back();
+                freeHandles.pop_back();
+                allocations[handle] = allocation;
+            }
+            else {
+                handle = static_cast<Handle>(allocations.size());
+                allocations.push_back(allocation);
+            }
+            return handle;
+        }
+
+        void free(Handle handle) {
+            if (handle >= allocations.size() || !allocations[handle].live) return;
+            Allocation& allocation = allocations[handle];
+            Pool& pool = pools[allocation.pool];
+            pool.vertexSpace.free(allocation.firstVertex, allocation.vertexCount);
+            pool.indexSpace.free(allocation.firstIndex, allocation.indexCount);
+            allocation.live = false;
+            freeHandles.push_back(handle);
+        }
+
+        // moves every allocation of every pool to the front of its buffers. offsets change, handles don't.
+        void defragment() {
+            for (uint32_t p = 0; p < pools.size(); ++p) defragment(p);
+        }
+
+        // everything needed to draw an allocation: the shared VAO and where the mesh starts in it
+        GLuint vao(Handle handle) const { return pools[allocations[handle].pool].vao; }
+        GLint baseVertex(Handle handle) const { return static_cast<GLint>(allocations[handle].firstVertex); }
+        uint32_t firstIndex(Handle handle) const { return allocations[handle].firstIndex; }
+
+        Stats stats() const {
+            Stats result = counters;
+            result.pools = pools.size();
+            result.allocations = allocations.size() - freeHandles.size();
+            for (const Pool& pool : pools) {
+                result.usedBytes += size_t(pool.vertexSpace.usedSize()) * pool.vertexStride + size_t(pool.indexSpace.usedSize()) * pool.indexStride;
+                result.capacityBytes += size_t(pool.vertexSpace.capacity()) * pool.vertexStride + size_t(pool.indexSpace.capacity()) * pool.indexStride;
+            }
+            return result;
+        }
+
+    private:
+        struct Pool {
+            bool packed = false;
+            GLenum indexType = GL_UNSIGNED_INT;
+            size_t vertexStride = 0, indexStride = 0;
+            GLuint vao = 0, vbo = 0, ebo = 0;
+            RangeAllocator vertexSpace, indexSpace;
+        };
+
+        struct Allocation {
+            uint32_t pool = 0;
+            uint32_t firstVertex = 0, vertexCount = 0;
+            uint32_t firstIndex = 0, indexCount = 0;
+            bool live = false;
+        };
+
+        uint32_t findOrCreatePool(bool packed, GLenum indexType) {
+            for (uint32_t p = 0; p < pools.size(); ++p) {
+                if (pools[p].packed == packed && pools[p].indexType == indexType) return p;
+            }
+
+            Pool pool;
+            pool.packed = packed;
+            pool.indexType = indexType;
+            pool.vertexStride = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+            pool.indexStride = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+            pool.vertexSpace.grow(initialVertices);
+            pool.indexSpace.grow(initialIndices);
+
+            glGenVertexArrays(1, &pool.vao);
+            pool.vbo = createBuffer(size_t(initialVertices) * pool.vertexStride);
+            pool.ebo = createBuffer(size_t(initialIndices) * pool.indexStride);
+            bindBuffers(pool);
+
+            pools.push_back(std::move(pool));
+            return static_cast<uint32_t>(pools.size() - 1);
+        }
+
+        static GLuint createBuffer(size_t bytes) {
+            GLuint buffer = 0;
+            glGenBuffers(1, &buffer);
+            glState.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+            return buffer;
+        }
+
+        // (re)attaches the pool's buffers to its VAO, needed whenever they were replaced
+        static void bindBuffers(const Pool& pool) {
+            glState.bindVertexArray(pool.vao);
+            glState.bindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+            setupVertexAttributes(pool.packed);
+            glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.ebo);
+        }
+
+        // makes room for count elements: compacts first if the free space is only fragmented, grows otherwise
+        bool reserve(Pool& pool, RangeAllocator& space, uint32_t count, bool vertices) {
+            if (count == 0 || space.largestFree() >= count) return true;
+
+            if (space.freeSize() >= count) {
+                defragment(static_cast<uint32_t>(&pool - pools.data()));
+                if (space.largestFree() >= count) return true;
+            }
+
+            uint64_t newCapacity = std::max<uint64_t>(uint64_t(space.capacity()) * 2, uint64_t(space.usedSize()) + count);
+            if (newCapacity > UINT32_MAX) return false;
+
+            size_t stride = vertices ? pool.vertexStride : pool.indexStride;
+            GLuint& buffer = vertices ? pool.vbo : pool.ebo;
+            GLuint grown = createBuffer(size_t(newCapacity) * stride);
+            glState.bindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glState.bindBuffer(GL_COPY_WRITE_BUFFER, grown);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size_t(space.capacity()) * stride);
+            glState.deleteBuffer(buffer);
+            buffer = grown;
+
+            space.grow(static_cast<uint32_t>(newCapacity));
+            bindBuffers(pool);
+            ++counters.grows;
+            return true;
+        }
+
+        // copies live allocations into fresh buffers in offset order; source and destination may not
+        // overlap in glCopyBufferSubData, so this can't be done in place
+        void defragment(uint32_t poolIndex) {
+            Pool& pool = pools[poolIndex];
+            std::vector<Allocation*> live;
+            for (Allocation& allocation : allocations) {
+                if (allocation.live && allocation.pool == poolIndex) live.push_back(&allocation);
+            }
+
+            GLuint vbo = createBuffer(size_t(pool.vertexSpace.capacity()) * pool.vertexStride);
+            GLuint ebo = createBuffer(size_t(pool.indexSpace.capacity()) * pool.indexStride);
+            uint32_t nextVertex = 0, nextIndex = 0;
+
+            std::sort(live.begin(), live.end(), [](const Allocation* a, const Allocation* b) { return a->firstVertex < b->firstVertex; });
+            glState.bindBuffer(GL_COPY_READ_BUFFER, pool.vbo);
+            glState.bindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+            for (Allocation* allocation : live) {
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(allocation->firstVertex) * pool.vertexStride,
+                    GLintptr(nextVertex) * pool.vertexStride, GLsizeiptr(allocation->vertexCount) * pool.vertexStride);
+                allocation->firstVertex = nextVertex;
+                nextVertex += allocation->vertexCount;
+            }
+
+            std::sort(live.begin(), live.end(), [](const Allocation* a, const Allocation* b) { return a->firstIndex < b->firstIndex; });
+            glState.bindBuffer(GL_COPY_READ_BUFFER, pool.ebo);
+            glState.bindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+            for (Allocation* allocation : live) {
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(allocation->firstIndex) * pool.indexStride,
+                    GLintptr(nextIndex) * pool.indexStride, GLsizeiptr(allocation->indexCount) * pool.indexStride);
+                allocation->firstIndex = nextIndex;
+                nextIndex += allocation->indexCount;
+            }
+
+            glState.deleteBuffer(pool.vbo);
+            glState.deleteBuffer(pool.ebo);
+            pool.vbo = vbo;
+            pool.ebo = ebo;
+            pool.vertexSpace.reset(nextVertex);
+            pool.indexSpace.reset(nextIndex);
+            bindBuffers(pool);
+            ++counters.defragmentations;
+        }
+
+        std::vector<Pool> pools;
+        std::vector<Allocation> allocations; // indexed by Handle
+        std::vector<Handle> freeHandles;
+        uint32_t initialVertices, initialIndices;
+        Stats counters;
+    };
+#pragma endregion
+}
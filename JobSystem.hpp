@@ -0,0 +1,269 @@
+#pragma once
+// fixed-size work-stealing scheduler for frame work. every worker owns a deque: it pushes and pops at
+// the back (newest first, its data is still in cache) and idle workers steal from the front of the
+// others. completion is tracked with JobCounters: scheduling a job adds one, finishing it takes one
+// away, wait() keeps running jobs until the counter is down to zero, and runAfter() holds a job back
+// until another counter is done. the thread that creates the system is worker 0 and runs jobs while it
+// waits, so parallelFor puts the main thread to work next to the others.
+// long blocking work (file IO, decoding) belongs on a ThreadPool instead, it would stall a frame here.
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define GAME_JOB_PAUSE() _mm_pause()
+#else
+#define GAME_JOB_PAUSE() std::this_thread::yield()
+#endif
+
+#include "ThreadPool.hpp"
+
+namespace Game {
+    class JobCounter;
+
+    struct Job {
+        std::function<void()> task;
+        JobCounter* counter = nullptr; // finished when task returns, may be null
+    };
+
+    // number of scheduled jobs that haven't finished. must outlive the jobs it counts; wait() on it
+    // before it goes out of scope.
+    class JobCounter {
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> pending{ 0 };
+        // the last decrement happens under this lock, so a waiter that takes it after seeing zero knows
+        // the finishing thread is done with the counter
+        std::mutex mutex;
+        std::vector<Job> continuations; // runAfter jobs, released when pending reaches zero
+    };
+
+    class JobSystem {
+    public:
+        // threadCount workers besides the calling thread, which becomes worker 0
+        explicit JobSystem(size_t threadCount = ThreadPool::defaultThreadCount()) : queueCount(threadCount + 1) {
+            queues = std::make_unique<WorkerQueue[]>(queueCount);
+            currentSystem = this;
+            currentIndex = 0;
+            workers.reserve(threadCount);
+            for (uint32_t i = 1; i < queueCount; ++i) {
+                workers.emplace_back([this, i] { workerLoop(i); });
+            }
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // jobs still queued are dropped, wait on their counters first
+        ~JobSystem() {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers) worker.join();
+            if (currentSystem == this) currentSystem = nullptr;
+        }
+
+        // workers including the owning thread
+        uint32_t workerCount() const { return queueCount; }
+
+        // index of the calling thread among this system's workers; threads that don't belong to it share 0
+        uint32_t workerIndex() const { return currentSystem == this ? currentIndex : 0; }
+
+        void run(std::function<void()> task, JobCounter* counter = nullptr) {
+            if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+            push({ std::move(task), counter });
+        }
+
+        // task is only queued once dependency is done; runs right away if it already is
+        void runAfter(JobCounter& dependency, std::function<void()> task, JobCounter* counter = nullptr) {
+            if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+            Job job{ std::move(task), counter };
+            {
+                std::lock_guard<std::mutex> lock(dependency.mutex);
+                if (dependency.pending.load(std::memory_order_acquire) != 0) {
+                    dependency.continuations.push_back(std::move(job));
+                    return;
+                }
+            }
+            push(std::move(job));
+        }
+
+        // runs queued jobs on this thread until counter is done
+        void wait(JobCounter& counter) {
+            uint32_t index = workerIndex();
+            uint32_t idle = 0;
+            while (!counter.done()) {
+                Job job;
+                if (tryTake(index, job)) {
+                    execute(job);
+                    idle = 0;
+                }
+                else if (++idle < 64) GAME_JOB_PAUSE();
+                else std::this_thread::yield();
+            }
+            std::lock_guard<std::mutex> lock(counter.mutex);
+        }
+
+        // calls function(begin, end) over [0, count) in chunks of grain items and returns when all are
+        // done. the calling thread takes the first chunk. chunk boundaries only depend on count and grain,
+        // so per-chunk output merged in chunk order (begin / grain) comes out the same as a serial loop.
+        template<typename Function>
+        void parallelFor(uint32_t count, uint32_t grain, Function&& function) {
+            if (count == 0) return;
+            grain = std::max<uint32_t>(grain, 1);
+            if (count <= grain || queueCount == 1) {
+                for (uint32_t begin = 0; begin < count; begin += grain) function(begin, std::min(count, begin + grain));
+                return;
+            }
+
+            JobCounter counter;
+            for (uint32_t begin = grain; begin < count; begin += grain) {
+                uint32_t end = std::min(count, begin + grain);
+                run([&function, begin, end] { function(begin, end); }, &counter);
+            }
+            function(0u, grain);
+            wait(counter);
+        }
+
+        static uint32_t chunkCount(uint32_t count, uint32_t grain) {
+            grain = std::max<uint32_t>(grain, 1);
+            return (count + grain - 1) / grain;
+        }
+
+        // a grain that gives every worker a few chunks to balance with, but no fewer than minGrain items each
+        uint32_t grainFor(uint32_t count, uint32_t minGrain = 16) const {
+            return std::max<uint32_t>(minGrain, count / (queueCount * 4));
+        }
+
+    private:
+        // padded so two workers' locks never share a cache line. a power of two ring rather than a
+        // std::deque, which frees and reallocates its blocks as jobs come and go; this one only grows.
+        struct alignas(64) WorkerQueue {
+            std::mutex mutex;
+            std::vector<Job> ring = std::vector<Job>(64);
+            size_t head = 0, count = 0;
+
+            void pushBack(Job&& job) {
+                if (count == ring.size()) {
+                    std::vector<Job> larger(ring.size() * 2);
+                    for (size_t i = 0; i < count; ++i) larger[i] = std::move(ring[(head + i) & (ring.size() - 1)]);
+                    ring.swap(larger);
+                    head = 0;
+                }
+                ring[(head + count) & (ring.size() - 1)] = std::move(job);
+                ++count;
+            }
+
+            Job popBack() {
+                --count;
+                return std::move(ring[(head + count) & (ring.size() - 1)]);
+            }
+
+            Job popFront() {
+                Job job = std::move(ring[head]);
+                head = (head + 1) & (ring.size() - 1);
+                --count;
+                return job;
+            }
+        };
+
+        void push(Job job) {
+            WorkerQueue& queue = queues[workerIndex()];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.pushBack(std::move(job));
+            }
+            queued.fetch_add(1);
+            if (sleeping.load() > 0) {
+                { std::lock_guard<std::mutex> lock(sleepMutex); }
+                wake.notify_one();
+            }
+        }
+
+        // own queue from the back, then the others from the front
+        bool tryTake(uint32_t index, Job& job) {
+            if (queued.load(std::memory_order_relaxed) == 0) return false;
+            for (uint32_t i = 0; i < queueCount; ++i) {
+                WorkerQueue& queue = queues[(index + i) % queueCount];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.count == 0) continue;
+                job = i == 0 ? queue.popBack() : queue.popFront();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        }
+
+        void execute(Job& job) {
+            job.task();
+            if (job.counter) finish(*job.counter);
+        }
+
+        void finish(JobCounter& counter) {
+            std::vector<Job> ready;
+            {
+                std::lock_guard<std::mutex> lock(counter.mutex);
+                if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+                ready.swap(counter.continuations);
+            }
+            for (Job& job : ready) push(std::move(job));
+        }
+
+        // spins for a while after running out of work, frame phases come in quick succession; then sleeps
+        void workerLoop(uint32_t index) {
+            currentSystem = this;
+            currentIndex = index;
+            uint32_t idle = 0;
+            for (;;) {
+                Job job;
+                if (tryTake(index, job)) {
+                    execute(job);
+                    idle = 0;
+                    continue;
+                }
+                if (++idle < 2048) {
+                    if (stopping.load(std::memory_order_relaxed)) return;
+                    GAME_JOB_PAUSE();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                sleeping.fetch_add(1);
+                wake.wait(lock, [this] { return stopping.load() || queued.load() > 0; });
+                sleeping.fetch_sub(1);
+                if (stopping.load()) return;
+                idle = 0;
+            }
+        }
+
+        uint32_t queueCount;
+        std::unique_ptr<WorkerQueue[]> queues;
+        std::vector<std::thread> workers;
+        std::atomic<uint32_t> queued{ 0 };   // jobs in all queues, so idle workers don't lock every queue
+        std::atomic<uint32_t> sleeping{ 0 };
+        std::atomic<bool> stopping{ false };
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+
+        static inline thread_local const JobSystem* currentSystem = nullptr;
+        static inline thread_local uint32_t currentIndex = 0;
+    };
+}
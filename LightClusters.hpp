@@ -0,0 +1,270 @@
+#pragma once
+// clustered light assignment for point and spot lights. the view frustum is cut into froxels, screen
+// tiles times depth slices (spaced exponentially, so the near ones stay thin), and every froxel gets the
+// list of lights whose range reaches into it. the fragment shader finds its own froxel and only loops
+// over that list, so the cost of a pixel follows how many lights overlap it, not how many exist.
+// binning runs on the job system: light bounds in parallel over lights, froxel lists in parallel over
+// depth slices, merged in slice order so the result doesn't depend on scheduling. the shader reads it
+// from texture buffers, GL 3.3 has no storage buffers: three texels per light, an offset/count pair
+// per froxel, and the light indices those pairs point into.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+#include <span>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+#include "UniformBuffers.hpp"
+#include "JobSystem.hpp"
+
+namespace Game {
+    struct PointLight {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 color = glm::vec3(1.0f);
+        float radius = 5.0f; // falls off to nothing here
+    };
+
+    struct SpotLight {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        glm::vec3 color = glm::vec3(1.0f);
+        float radius = 10.0f;
+        float innerAngle = glm::radians(20.0f); // half angles: full intensity inside inner, none past outer
+        float outerAngle = glm::radians(30.0f);
+    };
+
+    class LightClusters {
+    public:
+        static constexpr uint32_t tilesX = 16, tilesY = 9, slices = 24;
+        static constexpr uint32_t tileCount = tilesX * tilesY;
+        static constexpr uint32_t clusterCount = tileCount * slices;
+
+        // light data, froxel ranges and light indices sit on these units; the material texture has 0
+        static constexpr GLuint lightUnit = 1, clusterUnit = 2, indexUnit = 3;
+
+        struct Stats {
+            uint32_t lights = 0;           // point and spot lights, visible or not
+            uint32_t visibleLights = 0;    // reaching into at least one froxel
+            uint32_t references = 0;       // light indices over all froxels
+            uint32_t occupiedClusters = 0;
+            uint32_t maxPerCluster = 0;
+        };
+
+        // CPU only, so it can run off the GL thread (and in the benchmarks). lights are indexed points
+        // first, then spots. projection has to be a symmetric perspective like glm::perspective's.
+        void build(std::span<const PointLight> points, std::span<const SpotLight> spots, const glm::mat4& view, const glm::mat4& projection, JobSystem* jobs = nullptr) {
+            uint32_t lightCount = static_cast<uint32_t>(points.size() + spots.size());
+            gpuLights.resize(lightCount);
+            bounds.resize(lightCount);
+            setupFrustum(projection);
+
+            auto bin = [&](uint32_t first, uint32_t last) {
+                for (uint32_t i = first; i < last; ++i) {
+                    if (i < points.size()) {
+                        const PointLight& light = points[i];
+                        gpuLights[i] = { glm::vec4(light.position, light.radius), glm::vec4(light.color, 0.0f), glm::vec4(0.0f, -1.0f, 0.0f, 1.0f) };
+                        bounds[i] = lightBounds(glm::vec3(view * glm::vec4(light.position, 1.0f)), light.radius);
+                    }
+                    else {
+                        // the cone fades from 1 at the inner angle to 0 at the outer one: cos * scale + offset.
+                        // points get scale 0 and offset 1, so the shader needs no branch for them
+                        const SpotLight& light = spots[i - points.size()];
+                        float cosInner = std::cos(light.innerAngle), cosOuter = std::cos(light.outerAngle);
+                        float scale = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+                        gpuLights[i] = { glm::vec4(light.position, light.radius), glm::vec4(light.color, scale), glm::vec4(glm::normalize(light.direction), -cosOuter * scale) };
+                        // the whole sphere, not the cone: looser, but cheap and never misses a froxel
+                        bounds[i] = lightBounds(glm::vec3(view * glm::vec4(light.position, 1.0f)), light.radius);
+                    }
+                }
+            };
+            auto fill = [&](uint32_t first, uint32_t last) {
+                for (uint32_t slice = first; slice < last; ++slice) fillSlice(slice);
+            };
+            if (jobs) {
+                jobs->parallelFor(lightCount, jobs->grainFor(lightCount, 64), bin);
+                jobs->parallelFor(slices, 1, fill);
+            }
+            else {
+                bin(0, lightCount);
+                fill(0, slices);
+            }
+
+            // slices are laid out one after another in the index list
+            uint32_t references = 0;
+            for (uint32_t slice = 0; slice < slices; ++slice) {
+                sliceBase[slice] = references;
+                references += static_cast<uint32_t>(sliceIndices[slice].size());
+            }
+            indices.resize(references);
+            auto merge = [&](uint32_t first, uint32_t last) {
+                for (uint32_t slice = first; slice < last; ++slice) {
+                    std::copy(sliceIndices[slice].begin(), sliceIndices[slice].end(), indices.begin() + sliceBase[slice]);
+                    for (uint32_t tile = 0; tile < tileCount; ++tile) grid[(slice * tileCount + tile) * 2] += sliceBase[slice];
+                }
+            };
+            if (jobs) jobs->parallelFor(slices, 1, merge);
+            else merge(0, slices);
+
+            stats = {};
+            stats.lights = lightCount;
+            stats.references = references;
+            for (const LightBounds& light : bounds) stats.visibleLights += light.visible;
+            for (uint32_t cluster = 0; cluster < clusterCount; ++cluster) {
+                uint32_t count = grid[cluster * 2 + 1];
+                stats.occupiedClusters += count != 0;
+                stats.maxPerCluster = std::max(stats.maxPerCluster, count);
+            }
+        }
+
+        // GL thread: sends what the last build produced
+        void upload() {
+            lightBuffer.update(gpuLights.data(), gpuLights.size() * sizeof(GpuLight));
+            clusterBuffer.update(grid.data(), grid.size() * sizeof(uint32_t));
+            indexBuffer.update(indices.data(), indices.size() * sizeof(uint32_t));
+        }
+
+        // GL thread: the three buffers onto their units, before drawing with the lit shader
+        void bind() const {
+            lightBuffer.bind();
+            clusterBuffer.bind();
+            indexBuffer.bind();
+        }
+
+        // the grid layout the shader needs to find a fragment's froxel
+        void fillBlock(LightBlock& block, int viewportWidth, int viewportHeight) const {
+            block.counts.y = static_cast<int>(gpuLights.size());
+            block.clusterCounts = glm::ivec4(tilesX, tilesY, slices, 0);
+            block.clusterDepth = glm::vec4(sliceScale, sliceBias, nearPlane, farPlane);
+            block.clusterTile = glm::vec4(float(viewportWidth) / tilesX, float(viewportHeight) / tilesY, 0.0f, 0.0f);
+        }
+
+        // call before the context goes away
+        void release() {
+            lightBuffer.release();
+            clusterBuffer.release();
+            indexBuffer.release();
+        }
+
+        // lights reaching into a froxel, as indices into points then spots
+        std::span<const uint32_t> clusterLights(uint32_t x, uint32_t y, uint32_t slice) const {
+            uint32_t cluster = (slice * tilesY + y) * tilesX + x;
+            return { indices.data() + grid[cluster * 2], grid[cluster * 2 + 1] };
+        }
+
+        const Stats& getStats() const { return stats; }
+
+    private:
+        // three RGBA32F texels: position and radius, color and spot scale, direction and spot offset
+        struct GpuLight {
+            glm::vec4 positionRadius;
+            glm::vec4 colorScale;
+            glm::vec4 directionOffset;
+        };
+
+        // inclusive froxel ranges a light's sphere reaches into
+        struct LightBounds {
+            uint8_t minX = 0, maxX = 0, minY = 0, maxY = 0, minZ = 0, maxZ = 0;
+            bool visible = false;
+        };
+
+        // tile boundaries are planes through the eye; their normals point towards the higher tiles
+        void setupFrustum(const glm::mat4& projection) {
+            nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+            farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+            sliceScale = slices / std::log(farPlane / nearPlane);
+            sliceBias = -sliceScale * std::log(nearPlane);
+            for (uint32_t i = 0; i <= tilesX; ++i) {
+                float k = (-1.0f + 2.0f * i / tilesX) / projection[0][0];
+                columnPlanes[i] = glm::normalize(glm::vec2(1.0f, k)); // (x, z)
+            }
+            for (uint32_t i = 0; i <= tilesY; ++i) {
+                float k = (-1.0f + 2.0f * i / tilesY) / projection[1][1];
+                rowPlanes[i] = glm::normalize(glm::vec2(1.0f, k)); // (y, z)
+            }
+        }
+
+        uint32_t sliceOf(float depth) const {
+            float slice = std::log(std::max(depth, nearPlane)) * sliceScale + sliceBias;
+            return static_cast<uint32_t>(std::clamp(slice, 0.0f, float(slices - 1)));
+        }
+
+        // a tile column is between two planes; a sphere that isn't wholly outside either one may touch it
+        template<size_t planeCount>
+        static bool tileRange(const std::array<glm::vec2, planeCount>& planes, float a, float z, float radius, uint8_t& first, uint8_t& last) {
+            int lo = -1, hi = -1;
+            float below = glm::dot(planes[0], glm::vec2(a, z));
+            for (uint32_t i = 0; i + 1 < planeCount; ++i) {
+                float above = glm::dot(planes[i + 1], glm::vec2(a, z));
+                if (below > -radius && above < radius) {
+                    if (lo < 0) lo = int(i);
+                    hi = int(i);
+                }
+                below = above;
+            }
+            first = static_cast<uint8_t>(lo);
+            last = static_cast<uint8_t>(hi);
+            return lo >= 0;
+        }
+
+        LightBounds lightBounds(const glm::vec3& center, float radius) const {
+            LightBounds result;
+            float depth = -center.z;
+            if (depth + radius < nearPlane || depth - radius > farPlane) return result;
+            if (!tileRange(columnPlanes, center.x, center.z, radius, result.minX, result.maxX)) return result;
+            if (!tileRange(rowPlanes, center.y, center.z, radius, result.minY, result.maxY)) return result;
+            result.minZ = static_cast<uint8_t>(sliceOf(depth - radius));
+            result.maxZ = static_cast<uint8_t>(sliceOf(depth + radius));
+            result.visible = true;
+            return result;
+        }
+
+        // counts per froxel, then offsets, then the indices; lights stay in ascending order in every list
+        void fillSlice(uint32_t slice) {
+            uint32_t* ranges = grid.data() + slice * tileCount * 2;
+            std::fill(ranges, ranges + tileCount * 2, 0u);
+            auto forEachTile = [&](auto&& function) {
+                for (uint32_t i = 0; i < bounds.size(); ++i) {
+                    const LightBounds& light = bounds[i];
+                    if (!light.visible || slice < light.minZ || slice > light.maxZ) continue;
+                    for (uint32_t y = light.minY; y <= light.maxY; ++y) {
+                        for (uint32_t x = light.minX; x <= light.maxX; ++x) function(y * tilesX + x, i);
+                    }
+                }
+            };
+
+            forEachTile([&](uint32_t tile, uint32_t) { ++ranges[tile * 2 + 1]; });
+            uint32_t offset = 0;
+            for (uint32_t tile = 0; tile < tileCount; ++tile) {
+                ranges[tile * 2] = offset;
+                offset += ranges[tile * 2 + 1];
+            }
+
+            std::vector<uint32_t>& list = sliceIndices[slice];
+            list.resize(offset);
+            std::array<uint32_t, tileCount>& cursor = sliceCursors[slice];
+            for (uint32_t tile = 0; tile < tileCount; ++tile) cursor[tile] = ranges[tile * 2];
+            forEachTile([&](uint32_t tile, uint32_t light) { list[cursor[tile]++] = light; });
+        }
+
+        std::vector<GpuLight> gpuLights;
+        std::vector<LightBounds> bounds;
+        std::vector<uint32_t> grid = std::vector<uint32_t>(clusterCount * 2); // offset, count per froxel
+        std::vector<uint32_t> indices;
+        // per slice scratch, kept so a frame with as many lights as the last one allocates nothing
+        std::array<std::vector<uint32_t>, slices> sliceIndices;
+        std::array<std::array<uint32_t, tileCount>, slices> sliceCursors{};
+        std::array<uint32_t, slices> sliceBase{};
+
+        std::array<glm::vec2, tilesX + 1> columnPlanes;
+        std::array<glm::vec2, tilesY + 1> rowPlanes;
+        float nearPlane = 0.1f, farPlane = 100.0f, sliceScale = 0.0f, sliceBias = 0.0f;
+        Stats stats;
+
+        TextureBuffer lightBuffer{ lightUnit, GL_RGBA32F };
+        TextureBuffer clusterBuffer{ clusterUnit, GL_RG32UI };
+        TextureBuffer indexBuffer{ indexUnit, GL_R32UI };
+    };
+}
@@ -0,0 +1,280 @@
+#pragma once
+// on-disk cache of already imported/processed meshes, so warm starts skip Assimp entirely.
+// layout: Header followed by one 16-byte aligned block per section (vertices, indices, sub-meshes, ...).
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <filesystem>
+#include <iostream>
+#include <span>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "BaseProperties.hpp"
+
+namespace Game::MeshCache {
+#pragma region Format
+    constexpr uint32_t kMagic = 0x434D4742; // "BGMC"
+    constexpr uint32_t kVersion = 7;        // bump whenever a section's element type or the layout below changes
+
+    enum Section : uint32_t {
+        SectionVertices,
+        SectionIndices,
+        SectionSubMeshes,
+        SectionNodes,
+        SectionNodeMeshes,
+        SectionMeshlets,
+        SectionMaterialPaths,
+        SectionCount
+    };
+
+    struct SectionEntry {
+        uint64_t offset = 0;  // bytes from the start of the file
+        uint64_t count = 0;   // elements
+        uint32_t stride = 0;  // sizeof(element) when written, must match on load
+        uint32_t reserved = 0;
+    };
+
+    struct Header {
+        uint32_t magic = kMagic;
+        uint32_t version = kVersion;
+        uint32_t postProcessFlags = 0;   // aiProcess_* flags the data was imported with
+        uint32_t sectionCount = SectionCount;
+        uint64_t sourceHash = 0;         // hash of the source model file contents
+        uint32_t pipelineFlags = 0;      // our own processing on top of Assimp (MeshImportOptions::cacheKey)
+        uint32_t reserved = 0;
+        SectionEntry sections[SectionCount];
+    };
+
+    inline uint64_t alignUp(uint64_t value, uint64_t alignment = 16) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // 64-bit hash that eats 8 bytes per step; only has to be good enough to notice a changed source file
+    inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        uint64_t h = seed ^ (size * 0x9E3779B97F4A7C15ull);
+
+        auto mix = [](uint64_t k) {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdull;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53ull;
+            k ^= k >> 33;
+            return k;
+        };
+
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t k;
+            std::memcpy(&k, bytes + i, 8);
+            h = (h ^ mix(k)) * 0x100000001b3ull;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, bytes + i, size - i);
+        h = (h ^ mix(tail)) * 0x100000001b3ull;
+
+        return mix(h);
+    }
+#pragma endregion
+
+#pragma region MappedFile
+    // read-only memory mapping of a whole file
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+        MappedFile& operator=(MappedFile&& other) noexcept {
+            if (this != &other) {
+                close();
+                std::swap(ptr, other.ptr);
+                std::swap(length, other.length);
+#ifdef _WIN32
+                std::swap(file, other.file);
+                std::swap(mapping, other.mapping);
+#endif
+            }
+            return *this;
+        }
+        ~MappedFile() { close(); }
+
+        bool open(const std::string& path) {
+            close();
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return false;
+
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+            length = static_cast<size_t>(fileSize.QuadPart);
+
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping) { close(); return false; }
+
+            ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!ptr) { close(); return false; }
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+            length = static_cast<size_t>(st.st_size);
+
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd); // the mapping keeps its own reference
+            if (mapped == MAP_FAILED) { length = 0; return false; }
+            ptr = mapped;
+#endif
+            return true;
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (ptr) UnmapViewOfFile(ptr);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (ptr) munmap(ptr, length);
+#endif
+            ptr = nullptr;
+            length = 0;
+        }
+
+        const unsigned char* data() const { return static_cast<const unsigned char*>(ptr); }
+        size_t size() const { return length; }
+        explicit operator bool() const { return ptr != nullptr; }
+
+    private:
+        void* ptr = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
+    };
+#pragma endregion
+
+#pragma region ReadWrite
+    inline std::string cachePathFor(const std::string& sourcePath) {
+        return sourcePath + ".bgmesh";
+    }
+
+    inline bool hashFile(const std::string& path, uint64_t& outHash) {
+        MappedFile source;
+        if (!source.open(path)) return false;
+        outHash = hashBytes(source.data(), source.size());
+        return true;
+    }
+
+    // a validated cache file; the view's spans point straight into the mapping and stay valid while it is alive
+    struct View {
+        MappedFile file;
+        MeshView mesh;
+    };
+
+    inline bool load(const std::string& cachePath, uint64_t sourceHash, uint32_t postProcessFlags, uint32_t pipelineFlags, View& out) {
+        MappedFile file;
+        if (!file.open(cachePath) || file.size() < sizeof(Header)) return false;
+
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(Header));
+        if (header.magic != kMagic || header.version != kVersion || header.sectionCount != SectionCount) return false;
+        if (header.sourceHash != sourceHash || header.postProcessFlags != postProcessFlags || header.pipelineFlags != pipelineFlags) return false; // stale
+
+        bool valid = true;
+        auto section = [&]<typename T>(Section index, std::span<const T>& span) {
+            const SectionEntry& entry = header.sections[index];
+            if (entry.stride != sizeof(T) || entry.offset + entry.count * sizeof(T) > file.size()) {
+                valid = false;
+                return;
+            }
+            span = { reinterpret_cast<const T*>(file.data() + entry.offset), static_cast<size_t>(entry.count) };
+        };
+
+        MeshView mesh;
+        section(SectionVertices, mesh.vertices);
+        section(SectionIndices, mesh.indices);
+        section(SectionSubMeshes, mesh.subMeshes);
+        section(SectionNodes, mesh.nodes);
+        section(SectionNodeMeshes, mesh.nodeMeshes);
+        section(SectionMeshlets, mesh.meshlets);
+        section(SectionMaterialPaths, mesh.materialPaths);
+        if (!valid) {
+            std::cerr << "Mesh cache truncated or from an incompatible build: " << cachePath << std::endl;
+            return false;
+        }
+
+        out.mesh = mesh;
+        out.file = std::move(file);
+        return true;
+    }
+
+    inline bool write(const std::string& cachePath, uint64_t sourceHash, uint32_t postProcessFlags, uint32_t pipelineFlags, const MeshView& mesh) {
+        Header header;
+        header.sourceHash = sourceHash;
+        header.postProcessFlags = postProcessFlags;
+        header.pipelineFlags = pipelineFlags;
+
+        struct Block { const void* data; size_t bytes; };
+        Block blocks[SectionCount];
+        uint64_t offset = alignUp(sizeof(Header));
+        auto section = [&]<typename T>(Section index, std::span<const T> span) {
+            header.sections[index] = { offset, span.size(), static_cast<uint32_t>(sizeof(T)), 0 };
+            blocks[index] = { span.data(), span.size_bytes() };
+            offset = alignUp(offset + span.size_bytes());
+        };
+        section(SectionVertices, mesh.vertices);
+        section(SectionIndices, mesh.indices);
+        section(SectionSubMeshes, mesh.subMeshes);
+        section(SectionNodes, mesh.nodes);
+        section(SectionNodeMeshes, mesh.nodeMeshes);
+        section(SectionMeshlets, mesh.meshlets);
+        section(SectionMaterialPaths, mesh.materialPaths);
+
+        // write next to the target and rename, so a crash mid-write never leaves a valid-looking cache behind
+        std::string tempPath = cachePath + ".tmp";
+        FILE* out = std::fopen(tempPath.c_str(), "wb");
+        if (!out) return false;
+
+        static const unsigned char padding[16] = {};
+        bool ok = std::fwrite(&header, sizeof(Header), 1, out) == 1;
+        uint64_t written = sizeof(Header);
+        for (uint32_t i = 0; ok && i < SectionCount; ++i) {
+            uint64_t gap = header.sections[i].offset - written;
+            ok = std::fwrite(padding, 1, gap, out) == gap;
+            ok = ok && std::fwrite(blocks[i].data, 1, blocks[i].bytes, out) == blocks[i].bytes;
+            written = header.sections[i].offset + blocks[i].bytes;
+        }
+        ok = (std::fclose(out) == 0) && ok;
+
+        std::error_code ec;
+        if (ok) std::filesystem::rename(tempPath, cachePath, ec);
+        if (!ok || ec) {
+            std::filesystem::remove(tempPath, ec);
+            std::cerr << "Failed to write mesh cache: " << cachePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+#pragma endregion
+}
@@ -0,0 +1,320 @@
+#pragma once
+// CPU side of model loading: cache lookup, Assimp import and conversion to Vertex/index arrays.
+// nothing in here touches GL, so it is safe to run on worker threads.
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <span>
+#include <iostream>
+#include <print>
+#include <filesystem>
+
+#include "BaseProperties.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "VertexFormats.hpp"
+#include "Meshlets.hpp"
+
+namespace Game {
+    constexpr unsigned int meshImportFlags =
+        aiProcess_Triangulate |
+        aiProcess_GenNormals |
+        aiProcess_FlipUVs |
+        aiProcess_JoinIdenticalVertices;
+
+    // what happens to a mesh after the Assimp import. every option that changes the cached arrays has to
+    // show up in cacheKey, so caches written with different options are never mixed up. the upload
+    // formats are derived after the cache and don't count.
+    struct MeshImportOptions {
+        bool optimize = true;           // vertex cache, overdraw and vertex fetch ordering (MeshOptimizer.hpp)
+        bool reportOptimization = true; // print ACMR/ATVR before and after
+        bool generateLods = true;       // simplified index ranges per sub-mesh (MeshSimplifier.hpp)
+        bool buildMeshlets = true;      // cone/sphere culled clusters of the full resolution level (Meshlets.hpp)
+        bool packVertices = true;       // upload PackedVertex instead of Vertex (VertexFormats.hpp)
+        bool narrowIndices = true;      // 16-bit indices for meshes with at most 65536 vertices
+
+        uint32_t cacheKey() const {
+            return (optimize ? 1u : 0u) | (generateLods ? 2u : 0u) | (buildMeshlets ? 4u : 0u);
+        }
+    };
+
+    struct MeshData {
+        // what the rest of the engine reads: points into the owned arrays below after a fresh
+        // import, or straight into the mapped cache file on a cache hit
+        MeshView view;
+        bool fromCache = false;
+
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<SubMesh> subMeshes;
+        std::vector<MeshNode> nodes;
+        std::vector<uint32_t> nodeMeshes;
+        std::vector<Meshlet> meshlets;
+        std::vector<char> materialPaths;
+        MeshCache::MappedFile mapping;
+
+        // GPU-ready copies in the compact formats, filled on the worker when the import options ask for
+        // them. the cache keeps full precision, these are rebuilt from it on every load.
+        std::vector<PackedVertex> packedVertices;
+        std::vector<uint16_t> shortIndices;
+        AABB quantizationBounds;
+
+        MeshData() = default;
+        MeshData(const MeshData&) = delete;
+        MeshData& operator=(const MeshData&) = delete;
+
+        // point the view at the owned arrays, call after filling them
+        void bindOwnedArrays() {
+            view.vertices = vertices;
+            view.indices = indices;
+            view.subMeshes = subMeshes;
+            view.nodes = nodes;
+            view.nodeMeshes = nodeMeshes;
+            view.meshlets = meshlets;
+            view.materialPaths = materialPaths;
+        }
+
+        // the arrays are only needed until they are in GPU memory
+        void release() {
+            view = {};
+            vertices = {};
+            indices = {};
+            subMeshes = {};
+            nodes = {};
+            nodeMeshes = {};
+            meshlets = {};
+            materialPaths = {};
+            packedVertices = {};
+            shortIndices = {};
+            mapping.close();
+            fromCache = false;
+        }
+    };
+
+    inline glm::mat4 toGlm(const aiMatrix4x4& m) {
+        // assimp is row major, glm column major
+        return glm::mat4(
+            m.a1, m.b1, m.c1, m.d1,
+            m.a2, m.b2, m.c2, m.d2,
+            m.a3, m.b3, m.c3, m.d3,
+            m.a4, m.b4, m.c4, m.d4);
+    }
+
+    // flattens the node tree breadth first, so nodes end up sorted by depth and parents come before children
+    inline void flattenNodes(const aiNode* root, std::vector<MeshNode>& nodes, std::vector<uint32_t>& nodeMeshes) {
+        std::vector<std::pair<const aiNode*, int32_t>> queue{ { root, -1 } };
+        for (size_t head = 0; head < queue.size(); ++head) {
+            auto [node, parent] = queue[head];
+
+            MeshNode flat;
+            flat.local = toGlm(node->mTransformation);
+            flat.parent = parent;
+            flat.depth = parent < 0 ? 0 : nodes[parent].depth + 1;
+            flat.firstMesh = static_cast<uint32_t>(nodeMeshes.size());
+            flat.meshCount = node->mNumMeshes;
+            nodeMeshes.insert(nodeMeshes.end(), node->mMeshes, node->mMeshes + node->mNumMeshes);
+
+            int32_t index = static_cast<int32_t>(nodes.size());
+            nodes.push_back(flat);
+            for (unsigned int c = 0; c < node->mNumChildren; ++c) {
+                queue.push_back({ node->mChildren[c], index });
+            }
+        }
+    }
+
+    // the base color texture of every material, as written in the file, one after another with a null after
+    // each. textures embedded in the model ("*0" style paths) aren't supported and come out empty.
+    inline void collectMaterialPaths(const aiScene* scene, const std::string& modelPath, std::vector<char>& out) {
+        for (unsigned int m = 0; m < scene->mNumMaterials; ++m) {
+            const aiMaterial* material = scene->mMaterials[m];
+            aiString texture;
+            if (material->GetTexture(aiTextureType_BASE_COLOR, 0, &texture) != aiReturn_SUCCESS &&
+                material->GetTexture(aiTextureType_DIFFUSE, 0, &texture) != aiReturn_SUCCESS) {
+                texture = aiString();
+            }
+            std::string_view path = texture.C_Str();
+            if (path.starts_with('*')) {
+                std::cerr << "Embedded texture " << path << " in " << modelPath << " ignored" << std::endl;
+                path = {};
+            }
+            out.insert(out.end(), path.begin(), path.end());
+            out.push_back('\0');
+        }
+    }
+
+    // materialPaths of mesh made usable: relative paths are taken from the model's directory
+    inline std::vector<std::string> materialTexturePaths(const MeshView& mesh, const std::string& modelPath) {
+        std::vector<std::string> paths;
+        std::filesystem::path directory = std::filesystem::path(modelPath).parent_path();
+        const char* end = mesh.materialPaths.data() + mesh.materialPaths.size();
+        for (const char* begin = mesh.materialPaths.data(); begin < end;) {
+            const char* terminator = std::find(begin, end, '\0');
+            std::string_view path(begin, terminator);
+            begin = terminator + 1;
+            if (path.empty()) paths.emplace_back();
+            else paths.push_back((directory / std::filesystem::path(path)).lexically_normal().string());
+        }
+        return paths;
+    }
+
+    inline void prepareUploadFormats(MeshData& data, const MeshImportOptions& options) {
+        if (options.packVertices) {
+            data.quantizationBounds = packVertices(data.view.vertices, data.packedVertices);
+        }
+        if (options.narrowIndices) {
+            narrowIndices(data.view.indices, data.view.vertices.size(), data.shortIndices);
+        }
+    }
+
+    // grows capacity geometrically, so appending many meshes one by one stays linear; a no-op when the
+    // caller already reserved the whole file
+    template<typename T>
+    inline void reserveAtLeast(std::vector<T>& vector, size_t size) {
+        if (vector.capacity() < size) vector.reserve(std::max(size, vector.capacity() * 2));
+    }
+
+    inline size_t assimpIndexCount(const aiMesh* mesh) {
+        size_t count = 0;
+        for (unsigned int i = 0; i < mesh->mNumFaces; ++i) count += mesh->mFaces[i].mNumIndices;
+        return count;
+    }
+
+    // converts one Assimp mesh to Vertex/index arrays appended to out, as a new sub-mesh. indices are
+    // offset to point at the appended vertices.
+    inline void appendAssimpMesh(const aiMesh* mesh, MeshData& out) {
+        std::vector<Vertex>& vertices = out.vertices;
+        std::vector<unsigned int>& indices = out.indices;
+        size_t vertexOffset = vertices.size(); // number of vertices already in the vector
+        size_t indexOffset = indices.size();
+        size_t indexCount = assimpIndexCount(mesh);
+
+        reserveAtLeast(vertices, vertexOffset + mesh->mNumVertices);
+        reserveAtLeast(indices, indexOffset + indexCount);
+        vertices.resize(vertexOffset + mesh->mNumVertices);
+        indices.resize(indexOffset + indexCount);
+
+        for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+            glm::vec3 pos(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+            glm::vec3 norm(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+
+            glm::vec2 uv(0.0f, 0.0f);
+            if (mesh->mTextureCoords[0]) {
+                uv = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+            }
+
+            vertices[vertexOffset + i] = { pos, norm, uv };
+        }
+
+        unsigned int* index = indices.data() + indexOffset;
+        for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+            const aiFace& face = mesh->mFaces[i];
+            for (unsigned int j = 0; j < face.mNumIndices; ++j) {
+                *index++ = face.mIndices[j] + static_cast<unsigned int>(vertexOffset);
+            }
+        }
+
+        SubMesh subMesh;
+        subMesh.indexOffset = static_cast<uint32_t>(indexOffset);
+        subMesh.indexCount = static_cast<uint32_t>(indices.size() - indexOffset);
+        subMesh.vertexOffset = static_cast<uint32_t>(vertexOffset);
+        subMesh.vertexCount = mesh->mNumVertices;
+        subMesh.materialIndex = mesh->mMaterialIndex;
+        out.subMeshes.push_back(subMesh);
+    }
+
+    // everything after the raw triangles are in: optimization, LOD chain, meshlets and bounds. shared by
+    // the Assimp import and meshes generated in code; name only shows up in the report.
+    inline void processMeshData(MeshData& out, const MeshImportOptions& options, const std::string& name) {
+        std::vector<Vertex>& vertices = out.vertices;
+        std::vector<unsigned int>& indices = out.indices;
+
+        if (options.optimize) {
+            MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+            for (const SubMesh& subMesh : out.subMeshes) {
+                MeshOptimizer::optimizeSubMesh(vertices, indices, subMesh);
+            }
+            MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+            if (options.reportOptimization) {
+                std::println("Optimized {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", name, before.acmr, after.acmr, before.atvr, after.atvr);
+            }
+        }
+
+        // after the optimizer, so the simplified levels inherit its vertex order
+        if (options.generateLods) {
+            for (SubMesh& subMesh : out.subMeshes) {
+                MeshSimplifier::buildLodChain(vertices, indices, subMesh);
+            }
+        }
+
+        // cut from the final triangle order; the LOD levels only append, so level 0 ranges are still valid
+        if (options.buildMeshlets) {
+            for (SubMesh& subMesh : out.subMeshes) {
+                Meshlets::buildMeshlets(vertices, indices, subMesh, out.meshlets);
+            }
+        }
+
+        // bounds don't depend on the order, but the vertex ranges must be final
+        for (SubMesh& subMesh : out.subMeshes) {
+            std::span<const Vertex> subMeshVertices = std::span<const Vertex>(vertices).subspan(subMesh.vertexOffset, subMesh.vertexCount);
+            subMesh.bounds = computeBounds(subMeshVertices);
+            subMesh.sphere = computeBoundingSphere(subMeshVertices, subMesh.bounds);
+        }
+    }
+
+    inline bool loadMeshData(const std::string& path, MeshData& out, const MeshImportOptions& options = {}) {
+        uint64_t sourceHash = 0;
+        if (!MeshCache::hashFile(path, sourceHash)) {
+            std::cerr << "Failed to open model: " << path << std::endl;
+            return false;
+        }
+
+        // warm start: hand out the mapped cache file as is
+        std::string cachePath = MeshCache::cachePathFor(path);
+        MeshCache::View cached;
+        if (MeshCache::load(cachePath, sourceHash, meshImportFlags, options.cacheKey(), cached)) {
+            out.view = cached.mesh;
+            out.mapping = std::move(cached.file);
+            out.fromCache = true;
+            prepareUploadFormats(out, options);
+            return true;
+        }
+
+        Assimp::Importer importer; // initalize model importer and process model
+        const aiScene* scene = importer.ReadFile(path, meshImportFlags);
+
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+            std::cerr << "Assimp Error: " << importer.GetErrorString() << std::endl;
+            return false;
+        }
+
+        // size the arrays for the whole file once instead of growing them mesh by mesh
+        size_t vertexCount = 0, indexCount = 0;
+        for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+            vertexCount += scene->mMeshes[m]->mNumVertices;
+            indexCount += assimpIndexCount(scene->mMeshes[m]);
+        }
+        out.vertices.reserve(out.vertices.size() + vertexCount);
+        out.indices.reserve(out.indices.size() + indexCount);
+        out.subMeshes.reserve(out.subMeshes.size() + scene->mNumMeshes);
+
+        for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+            appendAssimpMesh(scene->mMeshes[m], out);
+        }
+
+        processMeshData(out, options, std::filesystem::path(path).filename().string());
+        flattenNodes(scene->mRootNode, out.nodes, out.nodeMeshes);
+        collectMaterialPaths(scene, path, out.materialPaths);
+
+        out.bindOwnedArrays();
+        MeshCache::write(cachePath, sourceHash, meshImportFlags, options.cacheKey(), out.view);
+        prepareUploadFormats(out, options);
+        return true;
+    }
+}
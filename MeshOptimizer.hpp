@@ -0,0 +1,248 @@
+#pragma once
+// index/vertex reordering for imported meshes: Forsyth's vertex cache optimization, cluster sorting to
+// cut overdraw and a vertex fetch remap, plus the usual ACMR/ATVR measurements. all functions work on one
+// sub-mesh at a time: an index range plus the vertex range it references (indices are absolute).
+
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdint>
+
+#include "BaseProperties.hpp"
+
+namespace Game::MeshOptimizer {
+    constexpr unsigned int defaultCacheSize = 16; // FIFO size used for analysis and overdraw clustering
+
+    struct CacheStats {
+        float acmr = 0.0f; // average cache miss ratio: transformed vertices per triangle (0.5 ideal, 3 worst)
+        float atvr = 0.0f; // average transform to vertex ratio: transformed vertices per unique vertex (1 ideal)
+    };
+
+    // simulates a FIFO post-transform cache over the whole index buffer
+    inline CacheStats analyzeVertexCache(std::span<const unsigned int> indices, size_t vertexCount, unsigned int cacheSize = defaultCacheSize) {
+        CacheStats stats;
+        if (indices.size() < 3) return stats;
+
+        std::vector<uint32_t> insertedAt(vertexCount, 0); // FIFO insertion time, 0 = never seen
+        std::vector<uint8_t> seen(vertexCount, 0);
+        uint32_t time = 0, misses = 0, unique = 0;
+        for (unsigned int index : indices) {
+            if (!seen[index]) { seen[index] = 1; ++unique; }
+            if (insertedAt[index] == 0 || time - insertedAt[index] >= cacheSize) {
+                insertedAt[index] = ++time;
+                ++misses;
+            }
+        }
+
+        stats.acmr = float(misses) / float(indices.size() / 3);
+        stats.atvr = unique ? float(misses) / float(unique) : 0.0f;
+        return stats;
+    }
+
+    // Tom Forsyth's linear-speed vertex cache optimization: greedily emits the triangle whose vertices
+    // score highest, where recently used vertices and vertices with few remaining triangles score more
+    inline void optimizeVertexCache(std::span<unsigned int> indices, uint32_t firstVertex, uint32_t vertexCount) {
+        constexpr int cacheSize = 32;
+        constexpr float cacheDecayPower = 1.5f;
+        constexpr float lastTriangleScore = 0.75f;
+        constexpr float valenceBoostScale = 2.0f;
+        constexpr float valenceBoostPower = 0.5f;
+
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) return;
+
+        auto vertexScore = [](int cachePosition, uint32_t remaining) {
+            if (remaining == 0) return -1.0f;
+            float score = 0.0f;
+            if (cachePosition >= 0) {
+                score = cachePosition < 3 ? lastTriangleScore
+                    : std::pow(1.0f - float(cachePosition - 3) / float(cacheSize - 3), cacheDecayPower);
+            }
+            return score + valenceBoostScale * std::pow(float(remaining), -valenceBoostPower);
+        };
+
+        // vertex -> triangles adjacency, compressed
+        std::vector<uint32_t> remaining(vertexCount, 0), offsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+        for (unsigned int index : indices.first(triangleCount * 3)) ++remaining[index - firstVertex];
+        for (uint32_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + remaining[v];
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (uint32_t t = 0; t < triangleCount; ++t) {
+                for (int c = 0; c < 3; ++c) adjacency[fill[indices[t * 3 + c] - firstVertex]++] = t;
+            }
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> score(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; ++v) score[v] = vertexScore(-1, remaining[v]);
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<uint8_t> emitted(triangleCount, 0);
+        for (uint32_t t = 0; t < triangleCount; ++t) {
+            triangleScore[t] = score[indices[t * 3] - firstVertex] + score[indices[t * 3 + 1] - firstVertex] + score[indices[t * 3 + 2] - firstVertex];
+        }
+
+        std::vector<unsigned int> output;
+        output.reserve(triangleCount * 3);
+        std::vector<uint32_t> cache, nextCache;
+        cache.reserve(cacheSize + 3);
+        nextCache.reserve(cacheSize + 3);
+
+        int64_t best = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+        size_t scanCursor = 0;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+            if (best < 0) {
+                // nothing in the cache touches an open triangle: continue with the next one in input order
+                while (emitted[scanCursor]) ++scanCursor;
+                best = static_cast<int64_t>(scanCursor);
+            }
+
+            uint32_t triangle = static_cast<uint32_t>(best);
+            emitted[triangle] = 1;
+
+            nextCache.clear();
+            for (int c = 0; c < 3; ++c) {
+                unsigned int index = indices[triangle * 3 + c];
+                output.push_back(index);
+
+                uint32_t v = index - firstVertex;
+                // drop the triangle from the vertex's open list
+                uint32_t* first = &adjacency[offsets[v]];
+                uint32_t* last = first + remaining[v];
+                *std::find(first, last, triangle) = *(last - 1);
+                --remaining[v];
+                if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) nextCache.push_back(v);
+            }
+            size_t triangleVertices = nextCache.size();
+            for (uint32_t v : cache) {
+                if (std::find(nextCache.begin(), nextCache.begin() + triangleVertices, v) == nextCache.begin() + triangleVertices) nextCache.push_back(v);
+            }
+
+            // vertices that fell out lose their cache bonus
+            for (size_t i = cacheSize; i < nextCache.size(); ++i) {
+                cachePosition[nextCache[i]] = -1;
+                score[nextCache[i]] = vertexScore(-1, remaining[nextCache[i]]);
+            }
+            if (nextCache.size() > size_t(cacheSize)) nextCache.resize(cacheSize);
+            std::swap(cache, nextCache);
+
+            for (size_t i = 0; i < cache.size(); ++i) {
+                cachePosition[cache[i]] = static_cast<int>(i);
+                score[cache[i]] = vertexScore(static_cast<int>(i), remaining[cache[i]]);
+            }
+
+            // only triangles around cached vertices changed score
+            best = -1;
+            float bestScore = -1.0f;
+            for (uint32_t v : cache) {
+                for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; ++a) {
+                    uint32_t t = adjacency[a];
+                    float s = score[indices[t * 3] - firstVertex] + score[indices[t * 3 + 1] - firstVertex] + score[indices[t * 3 + 2] - firstVertex];
+                    triangleScore[t] = s;
+                    if (s > bestScore) { bestScore = s; best = t; }
+                }
+            }
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    // splits the (already cache optimized) triangle order into clusters wherever the FIFO cache starts
+    // over, then draws outward-facing clusters first so they occlude the rest of the mesh
+    inline void optimizeOverdraw(std::span<unsigned int> indices, std::span<const Vertex> vertices, unsigned int cacheSize = defaultCacheSize) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) return;
+
+        std::vector<uint32_t> clusterStarts;
+        {
+            std::vector<uint32_t> insertedAt(vertices.size(), 0);
+            uint32_t time = 0;
+            for (uint32_t t = 0; t < triangleCount; ++t) {
+                int misses = 0;
+                for (int c = 0; c < 3; ++c) {
+                    unsigned int index = indices[t * 3 + c];
+                    if (insertedAt[index] == 0 || time - insertedAt[index] >= cacheSize) {
+                        insertedAt[index] = ++time;
+                        ++misses;
+                    }
+                }
+                if (t == 0 || misses == 3) clusterStarts.push_back(t);
+            }
+        }
+        if (clusterStarts.size() < 2) return;
+        clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+        auto position = [&](uint32_t t, int c) { return vertices[indices[t * 3 + c]].position; };
+
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        struct Cluster { uint32_t first, last; float sortKey; };
+        std::vector<Cluster> clusters(clusterStarts.size() - 1);
+        std::vector<glm::vec3> centroids(clusters.size()), normals(clusters.size());
+
+        for (size_t i = 0; i < clusters.size(); ++i) {
+            glm::vec3 centroid(0.0f), normal(0.0f);
+            float area = 0.0f;
+            for (uint32_t t = clusterStarts[i]; t < clusterStarts[i + 1]; ++t) {
+                glm::vec3 p0 = position(t, 0), p1 = position(t, 1), p2 = position(t, 2);
+                glm::vec3 n = glm::cross(p1 - p0, p2 - p0); // length = 2 * area
+                float a = glm::length(n);
+                centroid += (p0 + p1 + p2) * (a / 3.0f);
+                normal += n;
+                area += a;
+            }
+            meshCentroid += centroid;
+            meshArea += area;
+            centroids[i] = area > 0.0f ? centroid / area : position(clusterStarts[i], 0);
+            normals[i] = normal;
+            clusters[i] = { clusterStarts[i], clusterStarts[i + 1], 0.0f };
+        }
+        if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+        for (size_t i = 0; i < clusters.size(); ++i) {
+            float length = glm::length(normals[i]);
+            clusters[i].sortKey = length > 0.0f ? glm::dot(centroids[i] - meshCentroid, normals[i] / length) : 0.0f;
+        }
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+        std::vector<unsigned int> output;
+        output.reserve(triangleCount * 3);
+        for (const Cluster& cluster : clusters) {
+            output.insert(output.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+        }
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    // renumbers the sub-mesh's vertices in order of first use, so vertex fetches walk memory linearly.
+    // unreferenced vertices keep their slots at the end of the range.
+    inline void optimizeVertexFetch(std::span<Vertex> vertices, std::span<unsigned int> indices, uint32_t firstVertex) {
+        uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+        constexpr uint32_t unassigned = ~0u;
+        std::vector<uint32_t> remap(vertexCount, unassigned);
+
+        uint32_t next = 0;
+        for (unsigned int& index : indices) {
+            uint32_t v = index - firstVertex;
+            if (remap[v] == unassigned) remap[v] = next++;
+            index = firstVertex + remap[v];
+        }
+        for (uint32_t& slot : remap) {
+            if (slot == unassigned) slot = next++;
+        }
+
+        std::vector<Vertex> reordered(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; ++v) reordered[remap[v]] = vertices[v];
+        std::copy(reordered.begin(), reordered.end(), vertices.begin());
+    }
+
+    // all three passes over one sub-mesh, in the order they have to run
+    inline void optimizeSubMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const SubMesh& subMesh) {
+        std::span<unsigned int> subIndices = std::span<unsigned int>(indices).subspan(subMesh.indexOffset, subMesh.indexCount);
+        optimizeVertexCache(subIndices, subMesh.vertexOffset, subMesh.vertexCount);
+        optimizeOverdraw(subIndices, vertices);
+        optimizeVertexFetch(std::span<Vertex>(vertices).subspan(subMesh.vertexOffset, subMesh.vertexCount), subIndices, subMesh.vertexOffset);
+    }
+}
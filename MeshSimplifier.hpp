@@ -0,0 +1,243 @@
+#pragma once
+// LOD generation by quadric error edge collapse (Garland & Heckbert). collapses always move a vertex
+// onto one of its neighbours, so every level indexes the original vertex buffer and only adds indices.
+// vertices on borders and on attribute seams (several vertices at one position) never move, which
+// keeps levels crack free at the cost of simplifying heavily seamed meshes less.
+
+#include <vector>
+#include <span>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "BaseProperties.hpp"
+#include "MeshOptimizer.hpp"
+
+namespace Game::MeshSimplifier {
+    // symmetric 4x4 error matrix, upper triangle
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+
+        static Quadric fromPlane(const glm::vec3& n, float d, double weight) {
+            Quadric q;
+            q.a2 = weight * n.x * n.x; q.ab = weight * n.x * n.y; q.ac = weight * n.x * n.z; q.ad = weight * n.x * d;
+            q.b2 = weight * n.y * n.y; q.bc = weight * n.y * n.z; q.bd = weight * n.y * d;
+            q.c2 = weight * n.z * n.z; q.cd = weight * n.z * d;
+            q.d2 = weight * d * d;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& o) {
+            a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+            b2 += o.b2; bc += o.bc; bd += o.bd;
+            c2 += o.c2; cd += o.cd;
+            d2 += o.d2;
+            return *this;
+        }
+
+        double evaluate(const glm::vec3& p) const {
+            double x = p.x, y = p.y, z = p.z;
+            return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                 + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                 + c2 * z * z + 2 * cd * z
+                 + d2;
+        }
+    };
+
+    // returns at most targetTriangles triangles if the mesh allows it (absolute indices in, absolute out).
+    // vertices is the whole vertex array, [firstVertex, firstVertex + vertexCount) the range used.
+    inline std::vector<unsigned int> simplify(std::span<const unsigned int> indices, std::span<const Vertex> vertices,
+                                              uint32_t firstVertex, uint32_t vertexCount, size_t targetTriangles) {
+        size_t triangleCount = indices.size() / 3;
+        std::vector<uint32_t> tris(triangleCount * 3);
+        for (size_t i = 0; i < tris.size(); ++i) tris[i] = indices[i] - firstVertex;
+
+        auto position = [&](uint32_t v) { return vertices[firstVertex + v].position; };
+
+        // seams: more than one vertex at the same position
+        std::vector<uint8_t> locked(vertexCount, 0);
+        {
+            struct PositionHash {
+                size_t operator()(const glm::vec3& p) const {
+                    uint32_t bits[3];
+                    std::memcpy(bits, &p, sizeof(bits));
+                    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+                }
+            };
+            std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAtPosition;
+            for (uint32_t v = 0; v < vertexCount; ++v) {
+                auto [it, inserted] = firstAtPosition.try_emplace(position(v), v);
+                if (!inserted) locked[v] = locked[it->second] = 1;
+            }
+        }
+
+        // borders and non-manifold edges: anything not shared by exactly two triangles
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeUse;
+            edgeUse.reserve(triangleCount * 3);
+            for (size_t t = 0; t < triangleCount; ++t) {
+                for (int e = 0; e < 3; ++e) {
+                    uint32_t a = tris[t * 3 + e], b = tris[t * 3 + (e + 1) % 3];
+                    ++edgeUse[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)];
+                }
+            }
+            for (const auto& [edge, uses] : edgeUse) {
+                if (uses != 2) locked[edge >> 32] = locked[edge & 0xFFFFFFFFu] = 1;
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+        for (uint32_t t = 0; t < triangleCount; ++t) {
+            glm::vec3 p0 = position(tris[t * 3]), p1 = position(tris[t * 3 + 1]), p2 = position(tris[t * 3 + 2]);
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(n);
+            if (length > 0.0f) {
+                n /= length;
+                Quadric q = Quadric::fromPlane(n, -glm::dot(n, p0), 0.5 * length); // weighted by area
+                for (int c = 0; c < 3; ++c) quadrics[tris[t * 3 + c]] += q;
+            }
+            for (int c = 0; c < 3; ++c) vertexTriangles[tris[t * 3 + c]].push_back(t);
+        }
+
+        std::vector<uint8_t> triangleAlive(triangleCount, 1), collapsed(vertexCount, 0);
+        std::vector<uint32_t> version(vertexCount, 0);
+        size_t aliveTriangles = triangleCount;
+
+        struct Candidate {
+            double cost;
+            uint32_t from, to;
+            uint32_t fromVersion, toVersion;
+            bool operator>(const Candidate& o) const { return cost > o.cost; }
+        };
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> heap;
+
+        auto push = [&](uint32_t from, uint32_t to) {
+            if (locked[from]) return;
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            heap.push({ q.evaluate(position(to)), from, to, version[from], version[to] });
+        };
+        auto pushAround = [&](uint32_t v) {
+            for (uint32_t t : vertexTriangles[v]) {
+                if (!triangleAlive[t]) continue;
+                for (int c = 0; c < 3; ++c) {
+                    uint32_t w = tris[t * 3 + c];
+                    if (w == v) continue;
+                    push(v, w);
+                    push(w, v);
+                }
+            }
+        };
+        auto neighbours = [&](uint32_t v, std::vector<uint32_t>& out) {
+            out.clear();
+            for (uint32_t t : vertexTriangles[v]) {
+                if (!triangleAlive[t]) continue;
+                for (int c = 0; c < 3; ++c) {
+                    if (tris[t * 3 + c] != v) out.push_back(tris[t * 3 + c]);
+                }
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        };
+
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            if (!locked[v]) pushAround(v);
+        }
+
+        std::vector<uint32_t> fromNeighbours, toNeighbours;
+        while (aliveTriangles > targetTriangles && !heap.empty()) {
+            Candidate candidate = heap.top();
+            heap.pop();
+            uint32_t from = candidate.from, to = candidate.to;
+            if (collapsed[from] || collapsed[to]) continue;
+            if (version[from] != candidate.fromVersion || version[to] != candidate.toVersion) continue; // a newer entry exists
+
+            // link condition: an interior edge has exactly two common neighbours, more would pinch the surface
+            neighbours(from, fromNeighbours);
+            if (!std::binary_search(fromNeighbours.begin(), fromNeighbours.end(), to)) continue;
+            neighbours(to, toNeighbours);
+            size_t common = 0;
+            for (uint32_t v : fromNeighbours) common += std::binary_search(toNeighbours.begin(), toNeighbours.end(), v);
+            if (common != 2) continue;
+
+            // reject collapses that would fold a remaining triangle over, or tilt it so far that it
+            // degenerates into a sliver standing on edge
+            bool flips = false;
+            for (uint32_t t : vertexTriangles[from]) {
+                if (!triangleAlive[t]) continue;
+                const uint32_t* tri = &tris[t * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to) continue;
+
+                glm::vec3 p[3], moved[3];
+                for (int c = 0; c < 3; ++c) {
+                    p[c] = position(tri[c]);
+                    moved[c] = tri[c] == from ? position(to) : p[c];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) { flips = true; break; }
+            }
+            if (flips) continue;
+
+            for (uint32_t t : vertexTriangles[from]) {
+                if (!triangleAlive[t]) continue;
+                uint32_t* tri = &tris[t * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                    triangleAlive[t] = 0;
+                    --aliveTriangles;
+                    continue;
+                }
+                for (int c = 0; c < 3; ++c) {
+                    if (tri[c] == from) tri[c] = to;
+                }
+                vertexTriangles[to].push_back(t);
+            }
+            vertexTriangles[from].clear();
+            std::erase_if(vertexTriangles[to], [&](uint32_t t) { return !triangleAlive[t]; });
+
+            quadrics[to] += quadrics[from];
+            collapsed[from] = 1;
+            ++version[to];
+            pushAround(to);
+        }
+
+        std::vector<unsigned int> result;
+        result.reserve(aliveTriangles * 3);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            if (!triangleAlive[t]) continue;
+            for (int c = 0; c < 3; ++c) result.push_back(tris[t * 3 + c] + firstVertex);
+        }
+        return result;
+    }
+
+    // appends up to maxLodLevels - 1 coarser versions of the sub-mesh to indices, each about `ratio` of
+    // the previous one, and records their ranges in the sub-mesh. stops early once a level gets too small
+    // or the simplifier can't make progress (e.g. everything is seams).
+    inline void buildLodChain(std::span<const Vertex> vertices, std::vector<unsigned int>& indices, SubMesh& subMesh,
+                              float ratio = 0.5f, size_t minTriangles = 32) {
+        std::vector<unsigned int> previous(indices.begin() + subMesh.indexOffset, indices.begin() + subMesh.indexOffset + subMesh.indexCount);
+        subMesh.lodLevels = 1;
+
+        while (subMesh.lodLevels < maxLodLevels) {
+            size_t previousTriangles = previous.size() / 3;
+            size_t target = static_cast<size_t>(previousTriangles * ratio);
+            if (target < minTriangles) break;
+
+            std::vector<unsigned int> lod = simplify(previous, vertices, subMesh.vertexOffset, subMesh.vertexCount, target);
+            if (lod.size() / 3 > previousTriangles * 9 / 10) break; // not worth a level
+
+            MeshOptimizer::optimizeVertexCache(lod, subMesh.vertexOffset, subMesh.vertexCount);
+
+            subMesh.lods[subMesh.lodLevels - 1] = { static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.size()) };
+            indices.insert(indices.end(), lod.begin(), lod.end());
+            ++subMesh.lodLevels;
+            previous = std::move(lod);
+        }
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+// meshlets: small clusters of triangles (at most 64 vertices / 124 triangles) with a bounding sphere and
+// a normal cone each. clusters are cut from the sub-mesh's already optimized triangle order, so every
+// meshlet is a contiguous index range and nothing has to be reordered. per frame, clusters outside the
+// frustum or facing away from the camera are dropped and the survivors merged back into as few ranges
+// as possible for glMultiDrawElements.
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "BaseProperties.hpp"
+
+namespace Game::Meshlets {
+    constexpr uint32_t maxVertices = 64;
+    constexpr uint32_t maxTriangles = 124;
+
+    struct CullStats {
+        uint32_t tested = 0;
+        uint32_t frustumRejected = 0;
+        uint32_t backfaceRejected = 0;
+        uint64_t trianglesTested = 0;
+        uint64_t trianglesRejected = 0;
+
+        float triangleRejectionPercent() const { return trianglesTested ? 100.0f * trianglesRejected / trianglesTested : 0.0f; }
+
+        void add(const CullStats& other) {
+            tested += other.tested;
+            frustumRejected += other.frustumRejected;
+            backfaceRejected += other.backfaceRejected;
+            trianglesTested += other.trianglesTested;
+            trianglesRejected += other.trianglesRejected;
+        }
+    };
+
+    inline Meshlet computeMeshletBounds(std::span<const Vertex> vertices, std::span<const unsigned int> indices, uint32_t indexOffset, uint32_t indexCount) {
+        Meshlet meshlet;
+        meshlet.indexOffset = indexOffset;
+        meshlet.indexCount = indexCount;
+
+        AABB box;
+        glm::vec3 normalSum(0.0f);
+        std::vector<glm::vec3> normals;
+        normals.reserve(indexCount / 3);
+        for (uint32_t i = indexOffset; i < indexOffset + indexCount; i += 3) {
+            glm::vec3 p0 = vertices[indices[i]].position, p1 = vertices[indices[i + 1]].position, p2 = vertices[indices[i + 2]].position;
+            box.expand(p0); box.expand(p1); box.expand(p2);
+
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(n);
+            if (length > 0.0f) {
+                normals.push_back(n / length);
+                normalSum += n / length;
+            }
+        }
+
+        meshlet.center = box.center();
+        float radiusSq = 0.0f;
+        for (uint32_t i = indexOffset; i < indexOffset + indexCount; ++i) {
+            glm::vec3 d = vertices[indices[i]].position - meshlet.center;
+            radiusSq = std::max(radiusSq, glm::dot(d, d));
+        }
+        meshlet.radius = std::sqrt(radiusSq);
+
+        // cone around the average normal; too wide a spread (or no usable normal) means never back-facing
+        float axisLength = glm::length(normalSum);
+        meshlet.coneAxis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        float minDot = 1.0f;
+        for (const glm::vec3& n : normals) minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+        meshlet.coneCutoff = (axisLength > 0.0f && minDot > 0.1f) ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+        return meshlet;
+    }
+
+    // splits the sub-mesh's full resolution range into meshlets, in order, and records them in the sub-mesh
+    inline void buildMeshlets(std::span<const Vertex> vertices, std::span<const unsigned int> indices, SubMesh& subMesh, std::vector<Meshlet>& out) {
+        subMesh.firstMeshlet = static_cast<uint32_t>(out.size());
+        subMesh.meshletCount = 0;
+        if (subMesh.indexCount < 3) return;
+
+        std::vector<uint32_t> used; // vertices of the meshlet being built, small enough for a linear search
+        used.reserve(maxVertices);
+        uint32_t start = subMesh.indexOffset;
+        uint32_t end = subMesh.indexOffset + subMesh.indexCount;
+
+        auto flush = [&](uint32_t until) {
+            if (until == start) return;
+            out.push_back(computeMeshletBounds(vertices, indices, start, until - start));
+            ++subMesh.meshletCount;
+            start = until;
+            used.clear();
+        };
+
+        for (uint32_t i = start; i < end; i += 3) {
+            uint32_t added = 0;
+            for (int c = 0; c < 3; ++c) {
+                if (std::find(used.begin(), used.end(), indices[i + c]) == used.end()) ++added;
+            }
+            if (used.size() + added > maxVertices || (i - start) / 3 >= maxTriangles) flush(i);
+
+            for (int c = 0; c < 3; ++c) {
+                if (std::find(used.begin(), used.end(), indices[i + c]) == used.end()) used.push_back(indices[i + c]);
+            }
+        }
+        flush(end);
+    }
+
+    // appends the index ranges of the visible meshlets to ranges, merging neighbours. cameraPosition is in
+    // world space; backface enables the cone test. returns false if nothing survived.
+    inline bool cull(std::span<const Meshlet> meshlets, const glm::mat4& world, const Frustum& frustum, const glm::vec3& cameraPosition,
+                     std::vector<LodRange>& ranges, CullStats& stats, bool backface = true) {
+        glm::vec3 axisScale(glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])));
+        float maxScale = std::max({ axisScale.x, axisScale.y, axisScale.z });
+        float minScale = std::min({ axisScale.x, axisScale.y, axisScale.z });
+        // a non-uniform scale bends the cones, only trust them without one
+        bool coneCulling = backface && maxScale - minScale <= 1e-3f * maxScale;
+        glm::mat3 linear = glm::mat3(world);
+
+        size_t firstRange = ranges.size();
+        for (const Meshlet& meshlet : meshlets) {
+            ++stats.tested;
+            stats.trianglesTested += meshlet.indexCount / 3;
+
+            glm::vec3 center = glm::vec3(world * glm::vec4(meshlet.center, 1.0f));
+            float radius = meshlet.radius * maxScale;
+            if (!frustum.intersects(BoundingSphere{ center, radius })) {
+                ++stats.frustumRejected;
+                stats.trianglesRejected += meshlet.indexCount / 3;
+                continue;
+            }
+
+            if (coneCulling && meshlet.coneCutoff < 1.0f) {
+                glm::vec3 axis = linear * meshlet.coneAxis / maxScale;
+                glm::vec3 toCenter = center - cameraPosition;
+                if (glm::dot(toCenter, axis) >= meshlet.coneCutoff * glm::length(toCenter) + radius) {
+                    ++stats.backfaceRejected;
+                    stats.trianglesRejected += meshlet.indexCount / 3;
+                    continue;
+                }
+            }
+
+            if (ranges.size() > firstRange && ranges.back().indexOffset + ranges.back().indexCount == meshlet.indexOffset) {
+                ranges.back().indexCount += meshlet.indexCount;
+            }
+            else {
+                ranges.push_back({ meshlet.indexOffset, meshlet.indexCount });
+            }
+        }
+        return ranges.size() > firstRange;
+    }
+}
@@ -0,0 +1,317 @@
+#pragma once
+// software occlusion culling. a handful of occluder meshes are rasterized on the CPU into a small depth
+// buffer (split into horizontal bands that run as jobs), a max-depth pyramid is built on top,
+// and object bounds are tested against it before they are submitted. no GL involved, so it can run and
+// be measured without a context.
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GAME_OCCLUSION_SSE 1
+#include <immintrin.h>
+#endif
+
+#include "BaseProperties.hpp"
+#include "Profiler.hpp"
+#include "JobSystem.hpp"
+
+namespace Game {
+    class OcclusionCuller {
+    public:
+        // resolution of the depth buffer; width must stay a multiple of 4 for the SIMD row loop
+        static constexpr int width = 256;
+        static constexpr int height = 128;
+        static_assert(width % 4 == 0, "rows are rasterized four pixels at a time");
+
+        struct Stats {
+            uint32_t occluderTriangles = 0;
+            uint32_t tested = 0;
+            uint32_t rejected = 0;
+
+            float rejectedPercent() const { return tested ? 100.0f * rejected / tested : 0.0f; }
+
+            void add(const Stats& other) {
+                occluderTriangles += other.occluderTriangles;
+                tested += other.tested;
+                rejected += other.rejected;
+            }
+        };
+
+        size_t maxOccluderTriangles = 16384; // addOccluder refuses meshes past this
+
+        // jobs may be null, then every band is rasterized on the calling thread
+        explicit OcclusionCuller(JobSystem* jobs = nullptr, int bandCount = 4)
+            : jobs(jobs), bandCount(std::clamp(bandCount, 1, height)) {
+            bins.resize(this->bandCount);
+
+            size_t levelWidth = width, levelHeight = height, offset = 0;
+            for (;;) {
+                levels.push_back({ static_cast<int>(levelWidth), static_cast<int>(levelHeight), offset });
+                offset += levelWidth * levelHeight;
+                if (levelWidth == 1 && levelHeight == 1) break;
+                levelWidth = std::max<size_t>(levelWidth / 2, 1);
+                levelHeight = std::max<size_t>(levelHeight / 2, 1);
+            }
+            pyramid.resize(offset, 1.0f);
+        }
+
+        // clears occluders and stats; viewProjection is projection * view
+        void beginFrame(const glm::mat4& viewProjection) {
+            this->viewProjection = viewProjection;
+            triangles.clear();
+            for (std::vector<uint32_t>& bin : bins) bin.clear();
+            frameStats = {};
+        }
+
+        // indices point into vertices after subtracting baseVertex (model indices are absolute, a
+        // sub-mesh passes its own vertex range). triangles crossing the near plane are dropped, which
+        // only ever makes the occluder smaller, never wrong.
+        bool addOccluder(std::span<const Vertex> vertices, std::span<const unsigned int> indices, uint32_t baseVertex, const glm::mat4& model) {
+            if (triangles.size() + indices.size() / 3 > maxOccluderTriangles) return false;
+
+            glm::mat4 mvp = viewProjection * model;
+            clipVertices.resize(vertices.size());
+            for (size_t i = 0; i < vertices.size(); ++i) {
+                clipVertices[i] = mvp * glm::vec4(vertices[i].position, 1.0f);
+            }
+
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                ScreenTriangle triangle;
+                bool behindNear = false;
+                for (int c = 0; c < 3; ++c) {
+                    const glm::vec4& clip = clipVertices[indices[i + c] - baseVertex];
+                    if (clip.w <= nearW) { behindNear = true; break; }
+                    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+                    triangle.x[c] = (ndc.x * 0.5f + 0.5f) * width;
+                    triangle.y[c] = (ndc.y * 0.5f + 0.5f) * height;
+                    triangle.z[c] = ndc.z * 0.5f + 0.5f;
+                }
+                if (behindNear) continue;
+                if (!setup(triangle)) continue;
+
+                uint32_t index = static_cast<uint32_t>(triangles.size());
+                triangles.push_back(triangle);
+                for (int band = triangle.minY / bandHeight(); band <= std::min(triangle.maxY / bandHeight(), bandCount - 1); ++band) {
+                    bins[band].push_back(index);
+                }
+            }
+            frameStats.occluderTriangles = static_cast<uint32_t>(triangles.size());
+            return true;
+        }
+
+        // rasterizes every occluder and rebuilds the pyramid; blocks until all bands are done
+        void rasterize() {
+            if (jobs && bandCount > 1) {
+                jobs->parallelFor(static_cast<uint32_t>(bandCount), 1, [this](uint32_t first, uint32_t last) {
+                    for (uint32_t band = first; band < last; ++band) rasterizeBand(static_cast<int>(band));
+                });
+            }
+            else {
+                for (int band = 0; band < bandCount; ++band) rasterizeBand(band);
+            }
+            buildPyramid();
+        }
+
+        // false when the box is certainly hidden behind the occluders
+        bool isVisible(const AABB& worldBounds) {
+            return isVisible(worldBounds, frameStats);
+        }
+
+        // same, counting into stats instead of the frame's; safe to call from several jobs at once once
+        // rasterize is done. hand the counts back with addStats.
+        bool isVisible(const AABB& worldBounds, Stats& stats) const {
+            ++stats.tested;
+
+            float minX = float(width), minY = float(height), maxX = 0.0f, maxY = 0.0f, nearestDepth = 1.0f;
+            for (int corner = 0; corner < 8; ++corner) {
+                glm::vec3 p(corner & 1 ? worldBounds.max.x : worldBounds.min.x,
+                            corner & 2 ? worldBounds.max.y : worldBounds.min.y,
+                            corner & 4 ? worldBounds.max.z : worldBounds.min.z);
+                glm::vec4 clip = viewProjection * glm::vec4(p, 1.0f);
+                if (clip.w <= nearW) return true; // reaches past the camera, can't be hidden
+
+                glm::vec3 ndc = glm::vec3(clip) / clip.w;
+                float x = (ndc.x * 0.5f + 0.5f) * width;
+                float y = (ndc.y * 0.5f + 0.5f) * height;
+                minX = std::min(minX, x); maxX = std::max(maxX, x);
+                minY = std::min(minY, y); maxY = std::max(maxY, y);
+                nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+            }
+
+            int x0 = std::clamp(static_cast<int>(std::floor(minX)), 0, width - 1);
+            int x1 = std::clamp(static_cast<int>(std::floor(maxX)), 0, width - 1);
+            int y0 = std::clamp(static_cast<int>(std::floor(minY)), 0, height - 1);
+            int y1 = std::clamp(static_cast<int>(std::floor(maxY)), 0, height - 1);
+
+            // coarsest level where the rect still covers at most 2x2 texels
+            size_t level = 0;
+            while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+                ++level;
+            }
+
+            const Level& l = levels[level];
+            float farthest = 0.0f;
+            for (int y = y0 >> level; y <= std::min(y1 >> level, l.height - 1); ++y) {
+                for (int x = x0 >> level; x <= std::min(x1 >> level, l.width - 1); ++x) {
+                    farthest = std::max(farthest, pyramid[l.offset + y * l.width + x]);
+                }
+            }
+
+            if (nearestDepth > farthest + depthBias) {
+                ++stats.rejected;
+                return false;
+            }
+            return true;
+        }
+
+        const Stats& stats() const { return frameStats; }
+        void addStats(const Stats& stats) { frameStats.add(stats); }
+
+        // level 0 is the full resolution depth buffer, every further level holds the max of a 2x2 block
+        float depth(size_t level, int x, int y) const {
+            const Level& l = levels[level];
+            return pyramid[l.offset + y * l.width + x];
+        }
+        size_t levelCount() const { return levels.size(); }
+
+    private:
+        struct ScreenTriangle {
+            float x[3], y[3], z[3];
+            int minX, maxX, minY, maxY;
+            float dzdx, dzdy;
+        };
+
+        struct Level {
+            int width, height;
+            size_t offset;
+        };
+
+        static constexpr float nearW = 1e-4f;
+        static constexpr float depthBias = 1e-5f;
+
+        JobSystem* jobs;
+        int bandCount;
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+
+        std::vector<ScreenTriangle> triangles;
+        std::vector<std::vector<uint32_t>> bins; // triangle indices per band
+        std::vector<glm::vec4> clipVertices;     // scratch for addOccluder
+        std::vector<float> pyramid;              // all levels back to back
+        std::vector<Level> levels;
+        Stats frameStats;
+
+        int bandHeight() const { return (height + bandCount - 1) / bandCount; }
+
+        // counter-clockwise winding, screen bounds and depth gradients; false for degenerate or off-screen triangles
+        static bool setup(ScreenTriangle& t) {
+            float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+            if (std::abs(area) < 1e-8f) return false;
+            if (area < 0.0f) {
+                std::swap(t.x[1], t.x[2]);
+                std::swap(t.y[1], t.y[2]);
+                std::swap(t.z[1], t.z[2]);
+                area = -area;
+            }
+
+            float dx1 = t.x[1] - t.x[0], dy1 = t.y[1] - t.y[0], dz1 = t.z[1] - t.z[0];
+            float dx2 = t.x[2] - t.x[0], dy2 = t.y[2] - t.y[0], dz2 = t.z[2] - t.z[0];
+            t.dzdx = (dz1 * dy2 - dz2 * dy1) / area;
+            t.dzdy = (dx1 * dz2 - dx2 * dz1) / area;
+
+            t.minX = std::max(static_cast<int>(std::floor(std::min({ t.x[0], t.x[1], t.x[2] }))), 0);
+            t.maxX = std::min(static_cast<int>(std::ceil(std::max({ t.x[0], t.x[1], t.x[2] }))), width - 1);
+            t.minY = std::max(static_cast<int>(std::floor(std::min({ t.y[0], t.y[1], t.y[2] }))), 0);
+            t.maxY = std::min(static_cast<int>(std::ceil(std::max({ t.y[0], t.y[1], t.y[2] }))), height - 1);
+            return t.minX <= t.maxX && t.minY <= t.maxY;
+        }
+
+        void rasterizeBand(int band) {
+            GAME_PROFILE_ZONE("OcclusionBand");
+            int firstRow = band * bandHeight();
+            int lastRow = std::min(firstRow + bandHeight(), height) - 1;
+            std::fill(pyramid.begin() + firstRow * width, pyramid.begin() + (lastRow + 1) * width, 1.0f);
+
+            for (uint32_t index : bins[band]) {
+                const ScreenTriangle& t = triangles[index];
+
+                // edge functions a*x + b*y + c, positive inside for counter-clockwise triangles
+                float a[3], b[3], c[3];
+                for (int e = 0; e < 3; ++e) {
+                    int n = (e + 1) % 3;
+                    a[e] = t.y[e] - t.y[n];
+                    b[e] = t.x[n] - t.x[e];
+                    c[e] = -(a[e] * t.x[e] + b[e] * t.y[e]);
+                }
+
+                int x0 = t.minX & ~3; // aligned to the 4-wide row loop
+                int y0 = std::max(t.minY, firstRow);
+                int y1 = std::min(t.maxY, lastRow);
+                for (int y = y0; y <= y1; ++y) {
+                    float py = y + 0.5f;
+                    float* row = &pyramid[y * width];
+                    float rowDepth = t.z[0] + t.dzdy * (py - t.y[0]) + t.dzdx * (0.5f - t.x[0]);
+#ifdef GAME_OCCLUSION_SSE
+                    const __m128 zero = _mm_setzero_ps();
+                    const __m128 laneX = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+                    __m128 stepA[3], edge[3];
+                    for (int e = 0; e < 3; ++e) {
+                        __m128 px = _mm_add_ps(_mm_set1_ps(float(x0)), laneX);
+                        edge[e] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[e]), px), _mm_set1_ps(b[e] * py + c[e]));
+                        stepA[e] = _mm_set1_ps(a[e] * 4.0f);
+                    }
+                    __m128 z = _mm_add_ps(_mm_set1_ps(rowDepth), _mm_mul_ps(_mm_set1_ps(t.dzdx), _mm_add_ps(_mm_set1_ps(float(x0) - 0.5f), laneX)));
+                    const __m128 stepZ = _mm_set1_ps(t.dzdx * 4.0f);
+
+                    for (int x = x0; x <= t.maxX; x += 4) {
+                        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)), _mm_cmpge_ps(edge[2], zero));
+                        if (_mm_movemask_ps(inside)) {
+                            __m128 old = _mm_loadu_ps(row + x);
+                            __m128 nearer = _mm_min_ps(old, z);
+                            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+                        }
+                        for (int e = 0; e < 3; ++e) edge[e] = _mm_add_ps(edge[e], stepA[e]);
+                        z = _mm_add_ps(z, stepZ);
+                    }
+#else
+                    for (int x = x0; x <= t.maxX; ++x) {
+                        float px = x + 0.5f;
+                        bool inside = true;
+                        for (int e = 0; e < 3; ++e) inside = inside && a[e] * px + b[e] * py + c[e] >= 0.0f;
+                        if (inside) row[x] = std::min(row[x], rowDepth + t.dzdx * x);
+                    }
+#endif
+                }
+            }
+        }
+
+        void buildPyramid() {
+            GAME_PROFILE_ZONE("OcclusionPyramid");
+            for (size_t level = 1; level < levels.size(); ++level) {
+                const Level& src = levels[level - 1];
+                const Level& dst = levels[level];
+                for (int y = 0; y < dst.height; ++y) {
+                    for (int x = 0; x < dst.width; ++x) {
+                        // odd sizes: the last texel also covers the leftover row/column
+                        int sx0 = x * 2, sx1 = std::min(x * 2 + 1, src.width - 1);
+                        int sy0 = y * 2, sy1 = std::min(y * 2 + 1, src.height - 1);
+                        if (x == dst.width - 1) sx1 = src.width - 1;
+                        if (y == dst.height - 1) sy1 = src.height - 1;
+
+                        float farthest = 0.0f;
+                        for (int sy = sy0; sy <= sy1; ++sy) {
+                            for (int sx = sx0; sx <= sx1; ++sx) {
+                                farthest = std::max(farthest, pyramid[src.offset + sy * src.width + sx]);
+                            }
+                        }
+                        pyramid[dst.offset + y * dst.width + x] = farthest;
+                    }
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,95 @@
+#pragma once
+// meshes generated in code, for scenes that must not depend on asset files (benchmarks, CI). they go
+// through the same processing as imported models, so LODs, meshlets and packed formats are exercised too.
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <string>
+#include <vector>
+#include <cmath>
+
+#include "BaseProperties.hpp"
+#include "MeshLoader.hpp"
+
+namespace Game::ProceduralMesh {
+    // one sub-mesh over everything appended, then the regular import processing
+    inline void finish(MeshData& out, const MeshImportOptions& options, const std::string& name) {
+        SubMesh whole;
+        whole.indexOffset = 0;
+        whole.indexCount = static_cast<uint32_t>(out.indices.size());
+        whole.vertexOffset = 0;
+        whole.vertexCount = static_cast<uint32_t>(out.vertices.size());
+        out.subMeshes.push_back(whole);
+
+        processMeshData(out, options, name);
+        out.bindOwnedArrays();
+        prepareUploadFormats(out, options);
+    }
+
+    // grid of (columns + 1) x (rows + 1) vertices, two triangles per cell, counter-clockwise seen from outside
+    inline void appendGridIndices(std::vector<unsigned int>& indices, uint32_t firstVertex, uint32_t columns, uint32_t rows) {
+        for (uint32_t r = 0; r < rows; ++r) {
+            for (uint32_t c = 0; c < columns; ++c) {
+                uint32_t a = firstVertex + r * (columns + 1) + c;
+                uint32_t b = a + columns + 1;
+                indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+    }
+
+    inline void sphere(MeshData& out, float radius = 1.0f, uint32_t rings = 32, uint32_t segments = 64, const MeshImportOptions& options = {}) {
+        out.vertices.reserve(out.vertices.size() + size_t(rings + 1) * (segments + 1));
+        out.indices.reserve(out.indices.size() + size_t(rings) * segments * 6);
+        for (uint32_t r = 0; r <= rings; ++r) {
+            float v = float(r) / float(rings);
+            float theta = v * glm::pi<float>();
+            for (uint32_t s = 0; s <= segments; ++s) {
+                float u = float(s) / float(segments);
+                float phi = u * glm::two_pi<float>();
+                glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), -std::sin(theta) * std::sin(phi));
+                out.vertices.push_back({ normal * radius, normal, glm::vec2(u, v) });
+            }
+        }
+        appendGridIndices(out.indices, 0, segments, rings);
+        finish(out, options, "procedural sphere");
+    }
+
+    inline void torus(MeshData& out, float majorRadius = 1.0f, float minorRadius = 0.35f, uint32_t rings = 48, uint32_t sides = 24, const MeshImportOptions& options = {}) {
+        out.vertices.reserve(out.vertices.size() + size_t(rings + 1) * (sides + 1));
+        out.indices.reserve(out.indices.size() + size_t(rings) * sides * 6);
+        for (uint32_t r = 0; r <= rings; ++r) {
+            float u = float(r) / float(rings);
+            float phi = u * glm::two_pi<float>();
+            glm::vec3 ringCenter(std::cos(phi) * majorRadius, 0.0f, -std::sin(phi) * majorRadius);
+            for (uint32_t s = 0; s <= sides; ++s) {
+                float v = float(s) / float(sides);
+                float theta = v * glm::two_pi<float>();
+                glm::vec3 outward = glm::normalize(ringCenter);
+                glm::vec3 normal = outward * std::cos(theta) + glm::vec3(0.0f, 1.0f, 0.0f) * std::sin(theta);
+                out.vertices.push_back({ ringCenter + normal * minorRadius, normal, glm::vec2(u, v) });
+            }
+        }
+        appendGridIndices(out.indices, 0, sides, rings);
+        finish(out, options, "procedural torus");
+    }
+
+    // unit cube centered on the origin, hard edges (four vertices per face)
+    inline void box(MeshData& out, const glm::vec3& halfExtents = glm::vec3(0.5f), const MeshImportOptions& options = {}) {
+        const glm::vec3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        out.vertices.reserve(out.vertices.size() + 24);
+        out.indices.reserve(out.indices.size() + 36);
+        for (const glm::vec3& normal : normals) {
+            // tangent frame with right x up = normal, so the winding below faces outward
+            glm::vec3 up = std::abs(normal.y) > 0.5f ? glm::vec3(0, 0, normal.y > 0 ? -1 : 1) : glm::vec3(0, 1, 0);
+            glm::vec3 right = glm::cross(up, normal);
+            uint32_t first = static_cast<uint32_t>(out.vertices.size());
+            for (int corner = 0; corner < 4; ++corner) {
+                float x = (corner & 1) ? 1.0f : -1.0f;
+                float y = (corner & 2) ? 1.0f : -1.0f;
+                out.vertices.push_back({ (normal + right * x + up * y) * halfExtents, normal, glm::vec2(x * 0.5f + 0.5f, y * 0.5f + 0.5f) });
+            }
+            out.indices.insert(out.indices.end(), { first, first + 1, first + 3, first, first + 3, first + 2 });
+        }
+        finish(out, options, "procedural box");
+    }
+}
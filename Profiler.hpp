@@ -0,0 +1,277 @@
+#pragma once
+// CPU frame profiler. GAME_PROFILE_ZONE("name") times the enclosing scope into a ring buffer owned by the
+// calling thread (no locks on that path, the name must be a string literal). once per frame the main
+// thread drains every ring (GAME_PROFILE_FRAME), keeps per-zone frame totals for min/avg/p99 and, while
+// a capture is running, the raw events for a Chrome/Perfetto trace (chrome://tracing, ui.perfetto.dev).
+// compiled out unless GAME_PROFILING is 1, which is the default in builds without NDEBUG.
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <format>
+#include <print>
+#include <iostream>
+#include <cstdint>
+
+#ifndef GAME_PROFILING
+#ifdef NDEBUG
+#define GAME_PROFILING 0
+#else
+#define GAME_PROFILING 1
+#endif
+#endif
+
+namespace Game::Profiling {
+    struct ZoneEvent {
+        const char* name;
+        uint64_t startNs, endNs; // since the profiler's epoch
+    };
+
+    inline uint64_t nowNs() {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    // single producer (the owning thread), single consumer (Profiler::endFrame). the producer never waits:
+    // if the consumer falls a whole ring behind, the oldest events are overwritten and counted as dropped.
+    class ZoneRing {
+    public:
+        static constexpr size_t capacity = 1 << 14;
+
+        const uint32_t threadIndex;
+
+        explicit ZoneRing(uint32_t threadIndex) : threadIndex(threadIndex) {
+        }
+
+        void push(const ZoneEvent& event) {
+            uint64_t position = head.load(std::memory_order_relaxed);
+            events[position % capacity] = event;
+            head.store(position + 1, std::memory_order_release);
+        }
+
+        // appends everything written since the last drain to out, returns how many events were lost
+        uint64_t drain(std::vector<ZoneEvent>& out) {
+            uint64_t end = head.load(std::memory_order_acquire);
+            uint64_t start = std::max(tail, end > capacity ? end - capacity : 0);
+            uint64_t dropped = start - tail;
+
+            size_t first = out.size();
+            for (uint64_t i = start; i < end; ++i) out.push_back(events[i % capacity]);
+
+            // the producer may have lapped us while copying; whatever it reached is not trustworthy
+            uint64_t after = head.load(std::memory_order_acquire);
+            if (after > capacity && after - capacity > start) {
+                uint64_t overwritten = std::min(after - capacity, end) - start;
+                out.erase(out.begin() + first, out.begin() + first + overwritten);
+                dropped += overwritten;
+            }
+            tail = end;
+            return dropped;
+        }
+
+    private:
+        std::array<ZoneEvent, capacity> events{};
+        std::atomic<uint64_t> head{ 0 };
+        uint64_t tail = 0; // consumer only
+    };
+
+    struct ZoneStats {
+        std::string name;
+        double minMs = 0.0, avgMs = 0.0, p99Ms = 0.0, lastMs = 0.0; // per-frame totals over the history window
+        uint32_t callsLastFrame = 0;
+    };
+
+    class Profiler {
+    public:
+        static constexpr size_t historyFrames = 240;
+
+        static Profiler& instance() {
+            static Profiler profiler;
+            return profiler;
+        }
+
+        // the calling thread's ring, registered on first use and kept alive past thread exit
+        ZoneRing& threadRing() {
+            thread_local ZoneRing* ring = registerThread();
+            return *ring;
+        }
+
+        // drains every thread, closes the frame and updates the statistics; main thread only
+        void endFrame() {
+            uint64_t frameEnd = nowNs();
+            frameEvents.clear();
+            {
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                for (const std::unique_ptr<ZoneRing>& ring : rings) {
+                    size_t first = frameEvents.size();
+                    droppedEvents += ring->drain(frameEvents);
+                    if (capturing) {
+                        for (size_t i = first; i < frameEvents.size(); ++i) captured.push_back({ frameEvents[i], ring->threadIndex });
+                    }
+                }
+            }
+
+            ZoneEvent frame{ "Frame", frameStart, frameEnd };
+            frameEvents.push_back(frame);
+            if (capturing) captured.push_back({ frame, threadRing().threadIndex });
+            frameStart = frameEnd;
+
+            for (auto& [name, zone] : zones) {
+                zone.frameTotalNs = 0;
+                zone.calls = 0;
+            }
+            for (const ZoneEvent& event : frameEvents) {
+                ZoneHistory& zone = zones[event.name];
+                zone.frameTotalNs += event.endNs - event.startNs;
+                ++zone.calls;
+            }
+            for (auto& [name, zone] : zones) {
+                zone.history[zone.cursor++ % historyFrames] = zone.frameTotalNs;
+                zone.samples = std::min(zone.samples + 1, historyFrames);
+            }
+            ++frameIndex;
+
+            if (capturing && --captureFramesLeft == 0) {
+                capturing = false;
+                writeChromeTrace(capturePath);
+            }
+        }
+
+        // records the next frames' raw events and writes them to path once done
+        void captureTrace(uint32_t frames, std::string path) {
+            if (frames == 0 || capturing) return;
+            captured.clear();
+            capturePath = std::move(path);
+            captureFramesLeft = frames;
+            capturing = true;
+        }
+
+        bool captureInProgress() const { return capturing; }
+
+        // min/avg/p99 of each zone's per-frame total, slowest first
+        std::vector<ZoneStats> stats() const {
+            std::vector<ZoneStats> result;
+            std::vector<uint64_t> sorted;
+            for (const auto& [name, zone] : zones) {
+                if (zone.samples == 0) continue;
+                sorted.assign(zone.history.begin(), zone.history.begin() + zone.samples);
+                std::sort(sorted.begin(), sorted.end());
+
+                uint64_t sum = 0;
+                for (uint64_t ns : sorted) sum += ns;
+                size_t p99 = std::min(sorted.size() - 1, (sorted.size() * 99) / 100);
+
+                ZoneStats stat;
+                stat.name = name;
+                stat.minMs = sorted.front() * 1e-6;
+                stat.avgMs = double(sum) / double(sorted.size()) * 1e-6;
+                stat.p99Ms = sorted[p99] * 1e-6;
+                stat.lastMs = zone.frameTotalNs * 1e-6;
+                stat.callsLastFrame = zone.calls;
+                result.push_back(std::move(stat));
+            }
+            std::sort(result.begin(), result.end(), [](const ZoneStats& a, const ZoneStats& b) { return a.avgMs > b.avgMs; });
+            return result;
+        }
+
+        void printReport() const {
+            std::println("{:<24} {:>9} {:>9} {:>9} {:>6}   (ms per frame over the last {} frames)", "zone", "min", "avg", "p99", "calls", historyFrames);
+            for (const ZoneStats& stat : stats()) {
+                std::println("{:<24} {:>9.3f} {:>9.3f} {:>9.3f} {:>6}", stat.name, stat.minMs, stat.avgMs, stat.p99Ms, stat.callsLastFrame);
+            }
+            if (droppedEvents) std::println("{} zone events dropped (ring overflow)", droppedEvents);
+        }
+
+        bool writeChromeTrace(const std::string& path) const {
+            std::ofstream out(path, std::ios::binary);
+            if (!out) {
+                std::cerr << "Failed to write trace: " << path << std::endl;
+                return false;
+            }
+
+            // complete events ("ph":"X"), timestamps in microseconds
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            for (size_t i = 0; i < captured.size(); ++i) {
+                const CapturedEvent& event = captured[i];
+                out << std::format("{{\"name\":\"{}\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}{}\n",
+                    event.zone.name, event.thread, event.zone.startNs * 1e-3, (event.zone.endNs - event.zone.startNs) * 1e-3,
+                    i + 1 < captured.size() ? "," : "");
+            }
+            out << "]}\n";
+            std::println("Wrote {} trace events to {}", captured.size(), path);
+            return bool(out);
+        }
+
+    private:
+        struct ZoneHistory {
+            std::array<uint64_t, historyFrames> history{};
+            size_t samples = 0;
+            size_t cursor = 0; // per zone, zones created mid-run still fill the ring from slot 0
+            uint64_t frameTotalNs = 0;
+            uint32_t calls = 0;
+        };
+
+        struct CapturedEvent {
+            ZoneEvent zone;
+            uint32_t thread;
+        };
+
+        Profiler() : frameStart(nowNs()) {
+        }
+
+        ZoneRing* registerThread() {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(std::make_unique<ZoneRing>(static_cast<uint32_t>(rings.size())));
+            return rings.back().get();
+        }
+
+        std::mutex ringsMutex; // only taken on thread registration and once per frame
+        std::vector<std::unique_ptr<ZoneRing>> rings;
+
+        // main thread only
+        std::vector<ZoneEvent> frameEvents;
+        std::unordered_map<std::string_view, ZoneHistory> zones; // keyed by the literal's contents
+        uint64_t frameStart;
+        uint64_t frameIndex = 0;
+        uint64_t droppedEvents = 0;
+
+        std::vector<CapturedEvent> captured;
+        std::string capturePath;
+        uint32_t captureFramesLeft = 0;
+        bool capturing = false;
+    };
+
+    class ScopedZone {
+    public:
+        explicit ScopedZone(const char* name) : name(name), start(nowNs()) {
+        }
+        ~ScopedZone() {
+            Profiler::instance().threadRing().push({ name, start, nowNs() });
+        }
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+
+    private:
+        const char* name;
+        uint64_t start;
+    };
+}
+
+#if GAME_PROFILING
+#define GAME_PROFILE_CONCAT_INNER(a, b) a##b
+#define GAME_PROFILE_CONCAT(a, b) GAME_PROFILE_CONCAT_INNER(a, b)
+#define GAME_PROFILE_ZONE(name) ::Game::Profiling::ScopedZone GAME_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define GAME_PROFILE_FRAME() ::Game::Profiling::Profiler::instance().endFrame()
+#else
+#define GAME_PROFILE_ZONE(name) ((void)0)
+#define GAME_PROFILE_FRAME() ((void)0)
+#endif
@@ -0,0 +1,394 @@
+#pragma once
+// collects draw packets for a frame, sorts them by a packed state key and merges packets that share
+// program/mesh/texture into one instanced draw. per-instance data goes through a single instance buffer.
+// packets may be recorded by jobs into separate DrawLists, only flush needs the GL thread.
+// with GL 4.3 every run of equal state (one shared arena VAO, program and texture) becomes a single
+// glMultiDrawElementsIndirect, otherwise each instanced draw is issued on its own.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <span>
+#include <cstdint>
+
+#include "Resources.hpp"
+#include "TransformStore.hpp"
+#include "GeometryArena.hpp"
+#include "RenderStats.hpp"
+#include "GLState.hpp"
+
+namespace Game {
+    // per-instance vertex attributes: model at locations 3..6, normal matrix at 7..9
+    struct InstanceData {
+        glm::mat4 model;
+        NormalMatrix normal;
+    };
+
+    constexpr GLuint instanceAttribLocation = 3;
+    constexpr GLuint normalMatrixAttribLocation = 7;
+
+    // layout fixed by GL
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // the packets recorded for one frame, before sorting. a RenderQueue is one itself; jobs that record
+    // packets in parallel each fill their own list from RenderQueue::drawLists and flush merges them.
+    class DrawList {
+    public:
+        // key layout, most significant first: program (16 bits) | mesh VAO (24 bits) | texture (24 bits).
+        // GL names are small integers in practice, so truncating them keeps equal state adjacent after sorting.
+        static uint64_t makeSortKey(GLuint program, GLuint vao, GLuint texture) {
+            return (uint64_t(program & 0xFFFF) << 48) | (uint64_t(vao & 0xFFFFFF) << 24) | uint64_t(texture & 0xFFFFFF);
+        }
+
+        // lodLevel picks one of the sub-mesh's index ranges, clamped to the levels it has
+        void submit(GLuint program, const MeshResource& mesh, const SubMesh& subMesh, GLuint texture, const glm::mat4& model, const NormalMatrix& normal, uint32_t lodLevel = 0) {
+            packets.push_back({ makeSortKey(program, mesh.vao, texture), &mesh, &subMesh, subMesh.lodRange(lodLevel), program, texture, static_cast<uint32_t>(instances.size()) });
+            // packed meshes store positions as 0..1 within their bounds, undo that together with the model transform
+            instances.push_back({ mesh.packedVertices ? model * mesh.positionDequantize : model, normal });
+        }
+
+        // draws only the given index ranges of the sub-mesh (the meshlets that survived culling) in one
+        // multi-draw. the ranges are copied; such packets are never merged into instanced runs.
+        void submitClusters(GLuint program, const MeshResource& mesh, const SubMesh& subMesh, GLuint texture, const glm::mat4& model, const NormalMatrix& normal,
+                            std::span<const LodRange> ranges) {
+            if (ranges.empty()) return;
+            DrawPacket packet{ makeSortKey(program, mesh.vao, texture), &mesh, &subMesh, subMesh.lodRange(0), program, texture, static_cast<uint32_t>(instances.size()) };
+            packet.firstCluster = static_cast<uint32_t>(clusterRanges.size());
+            packet.clusterCount = static_cast<uint32_t>(ranges.size());
+            packets.push_back(packet);
+            clusterRanges.insert(clusterRanges.end(), ranges.begin(), ranges.end());
+            instances.push_back({ mesh.packedVertices ? model * mesh.positionDequantize : model, normal });
+        }
+
+        size_t size() const { return packets.size(); }
+
+    protected:
+        friend class RenderQueue; // merges other lists into its own
+
+        struct DrawPacket {
+            uint64_t key;
+            const MeshResource* mesh;
+            const SubMesh* subMesh;
+            LodRange range; // index range of the selected level
+            GLuint program;
+            GLuint texture;
+            uint32_t instance; // index into instances
+            uint32_t firstCluster = 0, clusterCount = 0; // ranges in clusterRanges, drawn instead of range
+        };
+
+        void clear() {
+            packets.clear();
+            instances.clear();
+            clusterRanges.clear();
+        }
+
+        std::vector<DrawPacket> packets;
+        std::vector<InstanceData> instances;
+        std::vector<LodRange> clusterRanges;
+    };
+
+    class RenderQueue : public DrawList {
+    public:
+        struct Stats {
+            size_t packets = 0;
+            size_t drawCalls = 0;        // GL draw calls actually issued
+            size_t indirectCommands = 0; // draws folded into them by the indirect path
+            size_t programSwitches = 0;
+            size_t triangles = 0;
+        };
+
+        bool useMultiDrawIndirect; // defaults to what the context supports, can be turned off to compare
+
+        // when set, flush times the buffer uploads ("Scene upload") and every batch it issues ("Scene batch",
+        // one per multi-draw or instanced run) as separate GPU passes. don't wrap flush in a pass of its
+        // own then, GL_TIME_ELAPSED queries can't nest.
+        GpuTimer* gpuTimer = nullptr;
+
+        // needs a current context
+        RenderQueue() : useMultiDrawIndirect(supportsMultiDrawIndirect()) {
+        }
+        RenderQueue(const RenderQueue&) = delete;
+        RenderQueue& operator=(const RenderQueue&) = delete;
+
+        ~RenderQueue() {
+            release();
+        }
+
+        // frees the instance and command buffers; call before the context goes away
+        void release() {
+            glState.deleteBuffer(instanceBuffer);
+            glState.deleteBuffer(indirectBuffer);
+            instanceBuffer = indirectBuffer = 0;
+            instanceCapacity = indirectCapacity = 0;
+        }
+
+        // count lists for jobs to record into, emptied by the next flush. resize here on the submitting
+        // thread, before the jobs start; the jobs then only touch their own list.
+        std::span<DrawList> drawLists(size_t count) {
+            if (extraLists.size() < count) extraLists.resize(count);
+            return std::span<DrawList>(extraLists).first(count);
+        }
+
+        // sorts, uploads all instance data in one go and issues the draws
+        void flush() {
+            mergeDrawLists();
+            lastStats = {};
+            lastStats.packets = packets.size();
+            if (packets.empty()) return;
+
+            // meshes in the arena share a VAO and so a key; keep each mesh's packets together, then order
+            // sub-meshes and LOD levels by range so equal ranges end up adjacent
+            std::sort(packets.begin(), packets.end(), [](const DrawPacket& a, const DrawPacket& b) {
+                if (a.key != b.key) return a.key < b.key;
+                if (a.mesh != b.mesh) return a.mesh->sortId != b.mesh->sortId ? a.mesh->sortId < b.mesh->sortId : a.mesh->path < b.mesh->path;
+                if (a.range.indexOffset != b.range.indexOffset) return a.range.indexOffset < b.range.indexOffset;
+                return a.subMesh->vertexOffset < b.subMesh->vertexOffset;
+            });
+
+            sortedInstances.resize(packets.size());
+            for (size_t i = 0; i < packets.size(); ++i) {
+                sortedInstances[i] = instances[packets[i].instance];
+            }
+            {
+                GpuPass pass(gpuTimer, "Scene upload");
+                uploadInstances();
+            }
+
+            // state left over from the last flush stays valid, glState skips whatever is already bound
+            if (useMultiDrawIndirect) flushIndirect();
+            else flushDirect();
+
+            renderCounters.draws += static_cast<uint32_t>(lastStats.drawCalls);
+            renderCounters.triangles += lastStats.triangles;
+            clear();
+        }
+
+        const Stats& stats() const { return lastStats; }
+
+    private:
+        // a run of packets in one indirect buffer slice, or a single instanced run for non-indexed meshes
+        struct Batch {
+            size_t firstPacket;
+            bool indirect;
+            size_t firstCommand, commandCount;
+            GLsizei instanceCount;
+        };
+
+        // a GpuTimer::Scope that does nothing without a timer
+        class GpuPass {
+        public:
+            GpuPass(GpuTimer* timer, const char* name) : timer(timer) { if (timer) timer->begin(name); }
+            ~GpuPass() { if (timer) timer->end(); }
+            GpuPass(const GpuPass&) = delete;
+            GpuPass& operator=(const GpuPass&) = delete;
+        private:
+            GpuTimer* timer;
+        };
+
+        // appends the job lists in index order, so the packets come out as if one thread had recorded them
+        void mergeDrawLists() {
+            for (DrawList& list : extraLists) {
+                if (list.packets.empty()) continue;
+                uint32_t instanceBase = static_cast<uint32_t>(instances.size());
+                uint32_t clusterBase = static_cast<uint32_t>(clusterRanges.size());
+                for (DrawPacket packet : list.packets) {
+                    packet.instance += instanceBase;
+                    packet.firstCluster += clusterBase;
+                    packets.push_back(packet);
+                }
+                instances.insert(instances.end(), list.instances.begin(), list.instances.end());
+                clusterRanges.insert(clusterRanges.end(), list.clusterRanges.begin(), list.clusterRanges.end());
+                list.clear();
+            }
+        }
+
+        // packets after first that can share its instanced draw
+        size_t runEnd(size_t first) const {
+            const DrawPacket& packet = packets[first];
+            size_t last = first + 1;
+            while (last < packets.size() && packet.clusterCount == 0 && packets[last].clusterCount == 0 &&
+                   packets[last].key == packet.key && packets[last].mesh == packet.mesh &&
+                   packets[last].range.indexOffset == packet.range.indexOffset && packets[last].subMesh->vertexOffset == packet.subMesh->vertexOffset) ++last;
+            return last;
+        }
+
+        void applyState(const DrawPacket& packet) {
+            if (glState.useProgram(packet.program)) ++lastStats.programSwitches;
+            glState.bindTexture(0, GL_TEXTURE_2D, packet.texture);
+        }
+
+        // GL 3.3 path: one draw per instanced run
+        void flushDirect() {
+            for (size_t first = 0; first < packets.size();) {
+                const DrawPacket& packet = packets[first];
+                size_t last = runEnd(first);
+                applyState(packet);
+
+                GpuPass pass(gpuTimer, "Scene batch");
+                if (packet.clusterCount) {
+                    drawClusters(packet, first);
+                }
+                else {
+                    drawInstanced(*packet.mesh, *packet.subMesh, packet.range, first, static_cast<GLsizei>(last - first));
+                    lastStats.triangles += (packet.mesh->indexCount ? packet.range.indexCount : packet.subMesh->vertexCount) / 3 * (last - first);
+                }
+                ++lastStats.drawCalls;
+                first = last;
+            }
+        }
+
+        // GL 4.3 path: every instanced run and every visible cluster range becomes a command, and all
+        // commands with the same key go out in one call. base instance replaces the attribute re-pointing.
+        void flushIndirect() {
+#ifdef GL_VERSION_4_3
+            commands.clear();
+            batches.clear();
+            for (size_t first = 0; first < packets.size();) {
+                const DrawPacket& packet = packets[first];
+                const MeshResource& mesh = *packet.mesh;
+                size_t last = runEnd(first);
+                bool indexed = mesh.indexCount != 0;
+
+                if (batches.empty() || !indexed || !batches.back().indirect || packets[batches.back().firstPacket].key != packet.key) {
+                    batches.push_back({ first, indexed, commands.size(), 0, static_cast<GLsizei>(last - first) });
+                }
+                if (!indexed) {
+                    lastStats.triangles += packet.subMesh->vertexCount / 3 * (last - first);
+                    first = last;
+                    continue;
+                }
+
+                GLuint firstIndex = mesh.firstIndex();
+                GLint baseVertex = mesh.baseVertex();
+                if (packet.clusterCount) {
+                    for (uint32_t i = packet.firstCluster; i < packet.firstCluster + packet.clusterCount; ++i) {
+                        commands.push_back({ clusterRanges[i].indexCount, 1, firstIndex + clusterRanges[i].indexOffset, baseVertex, static_cast<GLuint>(first) });
+                        lastStats.triangles += clusterRanges[i].indexCount / 3;
+                    }
+                }
+                else {
+                    commands.push_back({ packet.range.indexCount, static_cast<GLuint>(last - first), firstIndex + packet.range.indexOffset, baseVertex, static_cast<GLuint>(first) });
+                    lastStats.triangles += packet.range.indexCount / 3 * (last - first);
+                }
+                batches.back().commandCount = commands.size() - batches.back().firstCommand;
+                first = last;
+            }
+            lastStats.indirectCommands = commands.size();
+
+            {
+                GpuPass pass(gpuTimer, "Scene upload");
+                if (!indirectBuffer) glGenBuffers(1, &indirectBuffer);
+                glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+                size_t bytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+                if (bytes > indirectCapacity) {
+                    indirectCapacity = std::max<size_t>(bytes, indirectCapacity * 2);
+                }
+                glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, nullptr, GL_STREAM_DRAW);
+                glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands.data());
+                ++renderCounters.bufferUploads;
+            }
+
+            for (const Batch& batch : batches) {
+                const DrawPacket& packet = packets[batch.firstPacket];
+                applyState(packet);
+
+                GpuPass pass(gpuTimer, "Scene batch");
+                if (batch.indirect) {
+                    bindInstanceAttributes(*packet.mesh, 0);
+                    glMultiDrawElementsIndirect(GL_TRIANGLES, packet.mesh->indexType,
+                        (void*)(batch.firstCommand * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(batch.commandCount), 0);
+                }
+                else {
+                    drawInstanced(*packet.mesh, *packet.subMesh, packet.range, batch.firstPacket, batch.instanceCount);
+                }
+                ++lastStats.drawCalls;
+            }
+#else
+            flushDirect();
+#endif
+        }
+
+        void uploadInstances() {
+            if (!instanceBuffer) glGenBuffers(1, &instanceBuffer);
+            glState.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+            size_t bytes = sortedInstances.size() * sizeof(InstanceData);
+            if (bytes > instanceCapacity) {
+                instanceCapacity = std::max<size_t>(bytes, instanceCapacity * 2);
+            }
+            // orphan the old storage so we never wait on last frame's draws
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, sortedInstances.data());
+            ++renderCounters.bufferUploads;
+        }
+
+        void drawInstanced(const MeshResource& mesh, const SubMesh& subMesh, const LodRange& range, size_t firstInstance, GLsizei count) {
+            bindInstanceAttributes(mesh, firstInstance);
+
+            if (mesh.indexCount) {
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, mesh.indexType,
+                    (void*)((mesh.firstIndex() + range.indexOffset) * mesh.indexStride), count, mesh.baseVertex());
+            }
+            else {
+                glDrawArraysInstanced(GL_TRIANGLES, subMesh.vertexOffset, subMesh.vertexCount, count);
+            }
+        }
+
+        // a single instance: non-instanced draws read the divisor 1 attributes at element 0 of the run
+        void drawClusters(const DrawPacket& packet, size_t instance) {
+            const MeshResource& mesh = *packet.mesh;
+            bindInstanceAttributes(mesh, instance);
+
+            clusterCounts.clear();
+            clusterOffsets.clear();
+            clusterBaseVertices.assign(packet.clusterCount, mesh.baseVertex());
+            for (uint32_t i = packet.firstCluster; i < packet.firstCluster + packet.clusterCount; ++i) {
+                clusterCounts.push_back(static_cast<GLsizei>(clusterRanges[i].indexCount));
+                clusterOffsets.push_back((const void*)((mesh.firstIndex() + clusterRanges[i].indexOffset) * mesh.indexStride));
+                lastStats.triangles += clusterRanges[i].indexCount / 3;
+            }
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, clusterCounts.data(), mesh.indexType, clusterOffsets.data(),
+                static_cast<GLsizei>(packet.clusterCount), clusterBaseVertices.data());
+        }
+
+        void bindInstanceAttributes(const MeshResource& mesh, size_t firstInstance) {
+            glState.bindVertexArray(mesh.vao);
+
+            // without base instance (GL 3.3) the per-instance attributes are pointed at the run instead
+            glState.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+            size_t offset = firstInstance * sizeof(InstanceData);
+            for (GLuint column = 0; column < 4; ++column) {
+                GLuint location = instanceAttribLocation + column;
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(location, 1);
+            }
+            offset += offsetof(InstanceData, normal);
+            for (GLuint column = 0; column < 3; ++column) {
+                GLuint location = normalMatrixAttribLocation + column;
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(location, 1);
+            }
+        }
+
+        std::vector<InstanceData> sortedInstances;
+        std::vector<DrawList> extraLists;
+        std::vector<GLsizei> clusterCounts;
+        std::vector<const void*> clusterOffsets;
+        std::vector<GLint> clusterBaseVertices;
+        std::vector<DrawElementsIndirectCommand> commands;
+        std::vector<Batch> batches;
+
+        GLuint instanceBuffer = 0, indirectBuffer = 0;
+        size_t instanceCapacity = 0, indirectCapacity = 0;
+        Stats lastStats;
+    };
+}
@@ -0,0 +1,240 @@
+#pragma once
+// what the draw path costs: per-frame counters of draws and GL state changes, GPU time per pass from
+// GL_TIME_ELAPSED queries, and a frame log that can be dumped to CSV. queries are read back a few
+// frames late and only once the driver says they are done, so nothing here ever waits on the GPU.
+// the counters are plain CPU increments and work the same on every driver, Mesa's llvmpipe included.
+
+#include <glad/glad.h>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <format>
+#include <print>
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "Allocators.hpp"
+
+namespace Game {
+#pragma region RenderCounters
+    struct RenderCounters {
+        uint32_t draws = 0;          // GL draw calls (a multi-draw counts once)
+        uint64_t triangles = 0;
+        uint32_t programBinds = 0;
+        uint32_t textureBinds = 0;
+        uint32_t vaoBinds = 0;
+        uint32_t uniformUploads = 0; // glUniform* calls and uniform block updates
+        uint32_t bufferUploads = 0;  // instance, indirect, geometry arena, light cluster and texture pixel buffer writes
+        uint32_t redundantCalls = 0; // state changes glState dropped because nothing changed
+    };
+
+    // GL thread only; incremented wherever the matching GL call is made, reset by FrameStatsLog::endFrame
+    inline RenderCounters renderCounters;
+#pragma endregion
+
+#pragma region GpuTimer
+    // GL_TIME_ELAPSED queries can't nest, so passes are sequential: begin("Scene") ... end()
+    class GpuTimer {
+    public:
+        static constexpr int framesInFlight = 3;
+
+        struct PassTiming {
+            const char* name;
+            double ms;
+        };
+
+        GpuTimer() = default;
+        GpuTimer(const GpuTimer&) = delete;
+        GpuTimer& operator=(const GpuTimer&) = delete;
+
+        ~GpuTimer() {
+            release();
+        }
+
+        // call before the context goes away
+        void release() {
+            for (Frame& frame : frames) {
+                if (!frame.queries.empty()) glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+                frame = {};
+            }
+        }
+
+        // picks up the results of the oldest frame if the GPU is done with it, then starts a new one
+        void beginFrame() {
+            current = (current + 1) % framesInFlight;
+            Frame& frame = frames[current];
+            freshResults = false;
+            if (frame.used) {
+                GLint available = GL_FALSE;
+                glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (available) {
+                    lastResults.clear();
+                    for (size_t i = 0; i < frame.used; ++i) {
+                        GLuint64 ns = 0;
+                        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &ns);
+                        lastResults.push_back({ frame.names[i], ns * 1e-6 });
+                    }
+                    freshResults = true;
+                }
+                else {
+                    ++skippedFrames; // results are simply lost rather than waited for
+                }
+            }
+            frame.used = 0;
+            frame.names.clear();
+        }
+
+        void begin(const char* name) {
+            Frame& frame = frames[current];
+            if (frame.used == frame.queries.size()) {
+                GLuint query = 0;
+                glGenQueries(1, &query);
+                frame.queries.push_back(query);
+            }
+            frame.names.push_back(name);
+            glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.used++]);
+        }
+
+        void end() {
+            glEndQuery(GL_TIME_ELAPSED);
+        }
+
+        // newest complete frame, usually framesInFlight - 1 frames old
+        const std::vector<PassTiming>& results() const { return lastResults; }
+        double totalMs() const {
+            double total = 0.0;
+            for (const PassTiming& pass : lastResults) total += pass.ms;
+            return total;
+        }
+        // the slowest of the passes sharing a name, e.g. the draw batches RenderQueue times one by one
+        double maxMs(std::string_view name) const {
+            double slowest = 0.0;
+            for (const PassTiming& pass : lastResults) {
+                if (pass.name == name) slowest = std::max(slowest, pass.ms);
+            }
+            return slowest;
+        }
+        uint64_t skipped() const { return skippedFrames; }
+        // whether this frame's beginFrame picked up a new result; otherwise results() repeats an older frame
+        bool hasNewResults() const { return freshResults; }
+
+        class Scope {
+        public:
+            Scope(GpuTimer& timer, const char* name) : timer(timer) { timer.begin(name); }
+            ~Scope() { timer.end(); }
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        private:
+            GpuTimer& timer;
+        };
+
+    private:
+        struct Frame {
+            std::vector<GLuint> queries;
+            std::vector<const char*> names;
+            size_t used = 0;
+        };
+
+        Frame frames[framesInFlight];
+        int current = 0;
+        std::vector<PassTiming> lastResults;
+        bool freshResults = false;
+        uint64_t skippedFrames = 0;
+    };
+#pragma endregion
+
+#pragma region FrameStatsLog
+    // one row per frame: CPU time, the counters and the GPU pass times known at that point
+    class FrameStatsLog {
+    public:
+        size_t maxFrames = 36000; // oldest rows go first, about ten minutes at 60 Hz
+        static constexpr size_t maxPasses = 8; // GPU passes past this aren't logged
+
+        // heap allocations made by any thread during one frame (needs the counting operator new)
+        struct Allocations {
+            uint64_t count = 0;
+            uint64_t bytes = 0;
+        };
+
+        // records the frame and resets renderCounters for the next one. the rows are allocated up front,
+        // logging a frame doesn't allocate.
+        void endFrame(double cpuMs, const GpuTimer* gpu = nullptr) {
+            if (rows.capacity() < maxFrames) rows.reserve(maxFrames);
+
+            Allocations total{ allocationCounters.allocations.load(std::memory_order_relaxed), allocationCounters.bytes.load(std::memory_order_relaxed) };
+            Row row{ frameIndex++, cpuMs, renderCounters, { total.count - allocationsSeen.count, total.bytes - allocationsSeen.bytes }, {} };
+            allocationsSeen = total;
+            row.gpuMs.fill(-1.0f); // no result for that frame
+            if (gpu) {
+                for (const GpuTimer::PassTiming& pass : gpu->results()) {
+                    size_t column = columnFor(pass.name);
+                    if (column < maxPasses) row.gpuMs[column] = std::max(row.gpuMs[column], 0.0f) + static_cast<float>(pass.ms);
+                }
+            }
+            if (rows.size() >= maxFrames) rows.erase(rows.begin(), rows.begin() + std::min(rows.size(), maxFrames / 10 + 1));
+            rows.push_back(row);
+            renderCounters = {};
+        }
+
+        const RenderCounters& lastCounters() const {
+            static const RenderCounters none;
+            return rows.empty() ? none : rows.back().counters;
+        }
+
+        Allocations lastAllocations() const {
+            return rows.empty() ? Allocations{} : rows.back().allocations;
+        }
+
+        bool writeCsv(const std::string& path) const {
+            std::ofstream out(path);
+            if (!out) {
+                std::cerr << "Failed to write frame stats: " << path << std::endl;
+                return false;
+            }
+
+            out << "frame,cpu_ms,draws,triangles,program_binds,texture_binds,vao_binds,uniform_uploads,buffer_uploads,redundant_calls,allocations,allocated_bytes";
+            size_t passes = std::min(passColumns.size(), maxPasses);
+            for (size_t i = 0; i < passes; ++i) out << ",gpu_" << passColumns[i] << "_ms";
+            out << "\n";
+
+            for (const Row& row : rows) {
+                const RenderCounters& c = row.counters;
+                out << std::format("{},{:.4f},{},{},{},{},{},{},{},{},{},{}", row.frame, row.cpuMs, c.draws, c.triangles, c.programBinds,
+                    c.textureBinds, c.vaoBinds, c.uniformUploads, c.bufferUploads, c.redundantCalls, row.allocations.count, row.allocations.bytes);
+
+                for (size_t i = 0; i < passes; ++i) {
+                    if (row.gpuMs[i] < 0.0f) out << ",";
+                    else out << std::format(",{:.4f}", row.gpuMs[i]);
+                }
+                out << "\n";
+            }
+            std::println("Wrote {} frames of render stats to {}", rows.size(), path);
+            return bool(out);
+        }
+
+    private:
+        struct Row {
+            uint64_t frame;
+            double cpuMs;
+            RenderCounters counters;
+            Allocations allocations;
+            std::array<float, maxPasses> gpuMs; // by column, -1 = no result
+        };
+
+        size_t columnFor(const char* name) {
+            auto it = std::find(passColumns.begin(), passColumns.end(), name);
+            if (it != passColumns.end()) return static_cast<size_t>(it - passColumns.begin());
+            passColumns.emplace_back(name);
+            return passColumns.size() - 1;
+        }
+
+        std::vector<Row> rows;
+        std::vector<std::string> passColumns;
+        uint64_t frameIndex = 0;
+        Allocations allocationsSeen;
+    };
+#pragma endregion
+}
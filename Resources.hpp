@@ -0,0 +1,303 @@
+#pragma once
+// GPU resources shared between scene objects. the registry deduplicates by path and only holds
+// weak references, so a mesh/texture lives exactly as long as something in the scene uses it.
+
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <span>
+
+#include "BaseProperties.hpp"
+#include "MeshLoader.hpp"
+#include "AssetLoader.hpp"
+#include "GeometryArena.hpp"
+#include "TextureCache.hpp"
+
+namespace Game {
+#pragma region MeshResource
+    class MeshResource {
+    public:
+        const std::string path;
+        const uint64_t sortId; // hash of path; orders draws the same way on every run, unlike the address
+
+        GLuint vao = 0, vbo = 0, ebo = 0; // vbo/ebo stay 0 for meshes living in the arena
+        GLsizei vertexCount = 0, indexCount = 0;
+
+        // what the buffers actually hold, see VertexFormats.hpp
+        bool packedVertices = false;
+        GLenum indexType = GL_UNSIGNED_INT;
+        size_t vertexStride = sizeof(Vertex), indexStride = sizeof(unsigned int);
+        glm::mat4 positionDequantize = glm::mat4(1.0f); // folded into the instance model matrix by RenderQueue
+
+        // drawable ranges and the node hierarchy that places them; small, so always kept
+        std::vector<SubMesh> subMeshes;
+        std::vector<MeshNode> nodes;
+        std::vector<uint32_t> nodeMeshes;
+        std::vector<Meshlet> meshlets;
+        std::vector<std::string> materialTextures; // base color texture per material index, resolved; empty for none
+
+        // whole model in its rest pose, every sub-mesh placed by its node
+        AABB bounds;
+        BoundingSphere sphere;
+
+        // only kept when the registry was asked to (keepCpuData), e.g. for picking or physics
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+
+        // with an arena, indexed meshes are copied into its shared buffers instead of getting their own
+        MeshResource(std::string path, const MeshData& data, bool keepCpuData, GeometryArena* sharedArena = nullptr)
+            : path(std::move(path)), sortId(MeshCache::hashBytes(this->path.data(), this->path.size())) {
+            const MeshView& mesh = data.view;
+            upload(data, sharedArena);
+
+            subMeshes.assign(mesh.subMeshes.begin(), mesh.subMeshes.end());
+            nodes.assign(mesh.nodes.begin(), mesh.nodes.end());
+            nodeMeshes.assign(mesh.nodeMeshes.begin(), mesh.nodeMeshes.end());
+            meshlets.assign(mesh.meshlets.begin(), mesh.meshlets.end());
+            materialTextures = materialTexturePaths(mesh, this->path);
+
+            // meshes built by hand may come without a hierarchy: draw everything as one part
+            if (subMeshes.empty()) {
+                SubMesh whole{ 0, static_cast<uint32_t>(indexCount), 0, static_cast<uint32_t>(vertexCount), 0 };
+                whole.bounds = computeBounds(mesh.vertices);
+                whole.sphere = computeBoundingSphere(mesh.vertices, whole.bounds);
+                subMeshes.push_back(whole);
+            }
+            if (nodes.empty()) {
+                MeshNode root;
+                root.meshCount = static_cast<uint32_t>(subMeshes.size());
+                nodes.push_back(root);
+                nodeMeshes.clear();
+                for (uint32_t i = 0; i < subMeshes.size(); ++i) nodeMeshes.push_back(i);
+            }
+            computeModelBounds();
+
+            if (keepCpuData) {
+                vertices.assign(mesh.vertices.begin(), mesh.vertices.end());
+                indices.assign(mesh.indices.begin(), mesh.indices.end());
+            }
+        }
+
+        MeshResource(const MeshResource&) = delete;
+        MeshResource& operator=(const MeshResource&) = delete;
+
+        ~MeshResource() {
+            if (arena) arena->free(arenaHandle);
+            glState.deleteBuffer(ebo);
+            glState.deleteBuffer(vbo);
+            if (!arena) glState.deleteVertexArray(vao); // the arena's VAO is shared
+        }
+
+        size_t gpuBytes() const { return vertexCount * vertexStride + indexCount * indexStride; }
+        size_t cpuBytes() const { return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int); }
+
+        // where the mesh starts in its buffers: 0 for its own buffers, wherever the arena put it otherwise
+        // (which changes when the arena defragments, so read it at draw time)
+        GLint baseVertex() const { return arena ? arena->baseVertex(arenaHandle) : 0; }
+        uint32_t firstIndex() const { return arena ? arena->firstIndex(arenaHandle) : 0; }
+
+    private:
+        GeometryArena* arena = nullptr;
+        GeometryArena::Handle arenaHandle = GeometryArena::invalidHandle;
+
+        void computeModelBounds() {
+            std::vector<glm::mat4> globals(nodes.size());
+            for (size_t n = 0; n < nodes.size(); ++n) {
+                globals[n] = nodes[n].parent < 0 ? nodes[n].local : globals[nodes[n].parent] * nodes[n].local;
+                for (uint32_t i = 0; i < nodes[n].meshCount; ++i) {
+                    bounds.expand(subMeshes[nodeMeshes[nodes[n].firstMesh + i]].bounds.transformed(globals[n]));
+                }
+            }
+            if (!bounds.valid()) bounds = { glm::vec3(0.0f), glm::vec3(0.0f) };
+            sphere = { bounds.center(), glm::length(bounds.extents()) };
+        }
+
+        // takes the packed arrays when the loader produced them, the full precision view otherwise
+        void upload(const MeshData& data, GeometryArena* sharedArena) {
+            const MeshView& mesh = data.view;
+            vertexCount = static_cast<GLsizei>(mesh.vertices.size());
+            indexCount = static_cast<GLsizei>(mesh.indices.size());
+            packedVertices = !data.packedVertices.empty();
+
+            const void* vertexData = mesh.vertices.data();
+            if (packedVertices) {
+                vertexStride = sizeof(PackedVertex);
+                positionDequantize = dequantizeMatrix(data.quantizationBounds);
+                vertexData = data.packedVertices.data();
+            }
+            const void* indexData = mesh.indices.data();
+            if (!data.shortIndices.empty()) {
+                indexType = GL_UNSIGNED_SHORT;
+                indexStride = sizeof(uint16_t);
+                indexData = data.shortIndices.data();
+            }
+
+            // non-indexed meshes are drawn with glDrawArrays and rare enough to keep their own buffers
+            if (sharedArena && indexCount) {
+                arenaHandle = sharedArena->allocate(packedVertices, indexType, vertexData, vertexCount, indexData, indexCount);
+                if (arenaHandle != GeometryArena::invalidHandle) {
+                    arena = sharedArena;
+                    vao = arena->vao(arenaHandle);
+                    return;
+                }
+            }
+
+            glGenVertexArrays(1, &vao);
+            glGenBuffers(1, &vbo);
+            glState.bindVertexArray(vao);
+
+            glState.bindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexStride, vertexData, GL_STATIC_DRAW);
+
+            if (indexCount) {
+                glGenBuffers(1, &ebo);
+                glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexStride, indexData, GL_STATIC_DRAW);
+            }
+
+            setupVertexAttributes(packedVertices);
+        }
+    };
+#pragma endregion
+
+#pragma region ResourceRegistry
+    class ResourceRegistry {
+    public:
+        using MeshCallback = std::function<void(std::shared_ptr<MeshResource>)>;
+
+        bool keepCpuData = false; // keep vertex/index arrays around after upload
+        GeometryArena* arena = nullptr; // shared buffers for new meshes, must outlive them
+        TextureCache* textureCache = nullptr; // streams material textures; without one, models draw untextured
+        MeshImportOptions importOptions; // applied to every mesh loaded through the registry
+
+        struct MemoryStats {
+            size_t meshes = 0, textures = 0;
+            size_t gpuBytes = 0, cpuBytes = 0;
+        };
+
+        std::shared_ptr<MeshResource> findMesh(const std::string& path) {
+            auto it = meshes.find(path);
+            if (it == meshes.end()) return nullptr;
+
+            std::shared_ptr<MeshResource> mesh = it->second.lock();
+            if (!mesh) meshes.erase(it);
+            return mesh;
+        }
+
+        // registers decoded data under path; returns the existing resource if one is already alive
+        std::shared_ptr<MeshResource> createMesh(const std::string& path, const MeshData& data) {
+            if (std::shared_ptr<MeshResource> existing = findMesh(path)) return existing;
+
+            auto mesh = std::make_shared<MeshResource>(path, data, keepCpuData, arena);
+            meshes[path] = mesh;
+            return mesh;
+        }
+
+        // blocking load on the context thread
+        std::shared_ptr<MeshResource> loadMesh(const std::string& path) {
+            if (std::shared_ptr<MeshResource> existing = findMesh(path)) return existing;
+
+            MeshData data;
+            if (!loadMeshData(path, data, importOptions)) return nullptr;
+            return createMesh(path, data);
+        }
+
+        // background load through the AssetLoader. requests for a path that is already resident or
+        // already in flight don't decode the file again, they just get the same resource.
+        void loadMeshAsync(AssetLoader& loader, const std::string& path, MeshCallback onReady) {
+            if (std::shared_ptr<MeshResource> existing = findMesh(path)) {
+                onReady(existing);
+                return;
+            }
+
+            auto [it, firstRequest] = inFlight.try_emplace(path);
+            it->second.push_back(std::move(onReady));
+            if (!firstRequest) return;
+
+            loader.loadMesh(path,
+                [this, path](MeshData& data) {
+                    std::shared_ptr<MeshResource> mesh = createMesh(path, data);
+
+                    std::vector<MeshCallback> waiting = std::move(inFlight[path]);
+                    inFlight.erase(path);
+                    for (MeshCallback& callback : waiting) callback(mesh);
+                },
+                [this, path] {
+                    inFlight.erase(path); // nobody gets called back, a later request may retry
+                },
+                importOptions);
+        }
+
+        std::shared_ptr<TextureResource> findTexture(const std::string& path) {
+            auto it = textures.find(path);
+            if (it == textures.end()) return nullptr;
+
+            std::shared_ptr<TextureResource> texture = it->second.lock();
+            if (!texture) textures.erase(it);
+            return texture;
+        }
+
+        std::shared_ptr<TextureResource> createTexture(const std::string& path, GLsizei width, GLsizei height, const unsigned char* rgbPixels) {
+            if (std::shared_ptr<TextureResource> existing = findTexture(path)) return existing;
+
+            auto texture = std::make_shared<TextureResource>(path, width, height, rgbPixels);
+            textures[path] = texture;
+            return texture;
+        }
+
+        // streamed through the texture cache, null without one
+        std::shared_ptr<TextureResource> loadTexture(const std::string& path) {
+            return textureCache ? textureCache->load(path) : nullptr;
+        }
+
+        // one texture per material of mesh, indexed like SubMesh::materialIndex; null where the material has none
+        std::vector<std::shared_ptr<TextureResource>> materialTextures(const MeshResource& mesh) {
+            std::vector<std::shared_ptr<TextureResource>> textures(mesh.materialTextures.size());
+            for (size_t i = 0; i < textures.size(); ++i) {
+                if (!mesh.materialTextures[i].empty()) textures[i] = loadTexture(mesh.materialTextures[i]);
+            }
+            return textures;
+        }
+
+        // 1x1 white, for meshes without a material texture
+        std::shared_ptr<TextureResource> defaultWhiteTexture() {
+            static const unsigned char whitePixel[3] = { 255, 255, 255 }; // RGB
+            return createTexture("<white>", 1, 1, whitePixel);
+        }
+
+        // drops expired entries and sums up what is still alive
+        MemoryStats memoryStats() {
+            MemoryStats stats;
+            std::erase_if(meshes, [](const auto& entry) { return entry.second.expired(); });
+            std::erase_if(textures, [](const auto& entry) { return entry.second.expired(); });
+
+            for (const auto& [path, weak] : meshes) {
+                if (std::shared_ptr<MeshResource> mesh = weak.lock()) {
+                    ++stats.meshes;
+                    stats.gpuBytes += mesh->gpuBytes();
+                    stats.cpuBytes += mesh->cpuBytes();
+                }
+            }
+            for (const auto& [path, weak] : textures) {
+                if (std::shared_ptr<TextureResource> texture = weak.lock()) {
+                    ++stats.textures;
+                    stats.gpuBytes += texture->gpuBytes();
+                }
+            }
+            if (textureCache) {
+                stats.textures += textureCache->stats().textures;
+                stats.gpuBytes += textureCache->stats().residentBytes;
+            }
+            return stats;
+        }
+
+    private:
+        std::unordered_map<std::string, std::weak_ptr<MeshResource>> meshes;
+        std::unordered_map<std::string, std::weak_ptr<TextureResource>> textures;
+        std::unordered_map<std::string, std::vector<MeshCallback>> inFlight;
+    };
+#pragma endregion
+}
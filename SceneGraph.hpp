@@ -0,0 +1,108 @@
+#pragma once
+// transform hierarchy stored as a flat array with parents before children. changes only set dirty
+// flags; update() does a single forward pass and recomputes just the dirty nodes and their descendants.
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#include "BaseProperties.hpp"
+#include "TransformStore.hpp"
+
+namespace Game {
+    class SceneGraph {
+    public:
+        using NodeIndex = uint32_t;
+        static constexpr int32_t noParent = -1;
+
+        SceneGraph() = default;
+
+        // copies a model's node hierarchy; node i here is node i of the model
+        explicit SceneGraph(std::span<const MeshNode> modelNodes) {
+            reserve(modelNodes.size());
+            for (const MeshNode& node : modelNodes) {
+                addNode(node.parent, node.local);
+            }
+        }
+
+        void reserve(size_t nodeCount) {
+            parents.reserve(nodeCount);
+            locals.reserve(nodeCount);
+            worlds.reserve(nodeCount);
+            normals.reserve(nodeCount);
+            flags.reserve(nodeCount);
+        }
+
+        // parent must already exist, which keeps every parent in front of its children
+        NodeIndex addNode(int32_t parent, const glm::mat4& local) {
+            NodeIndex index = static_cast<NodeIndex>(parents.size());
+            parents.push_back(parent);
+            locals.push_back(local);
+            worlds.push_back(glm::mat4(1.0f));
+            normals.push_back({});
+            flags.push_back(Dirty);
+            anyDirty = true;
+            return index;
+        }
+
+        void setLocal(NodeIndex node, const glm::mat4& local) {
+            locals[node] = local;
+            flags[node] |= Dirty;
+            anyDirty = true;
+        }
+
+        // transform of whatever the roots hang off, e.g. the owning object's world matrix.
+        // only dirties the graph when the matrix actually changed.
+        void setParentTransform(const glm::mat4& parentWorld) {
+            if (parentWorld == rootParent) return;
+            rootParent = parentWorld;
+            for (NodeIndex i = 0; i < parents.size(); ++i) {
+                if (parents[i] == noParent) flags[i] |= Dirty;
+            }
+            anyDirty = true;
+        }
+
+        // returns the number of nodes recomputed
+        size_t update() {
+            if (!anyDirty) return 0;
+
+            size_t updated = 0;
+            for (NodeIndex i = 0; i < parents.size(); ++i) {
+                int32_t parent = parents[i];
+                bool parentChanged = parent != noParent && (flags[parent] & Changed);
+                if (!(flags[i] & Dirty) && !parentChanged) continue;
+
+                worlds[i] = (parent == noParent ? rootParent : worlds[parent]) * locals[i];
+
+                glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(worlds[i])));
+                for (int c = 0; c < 3; ++c) normals[i].columns[c] = glm::vec4(normal[c], 0.0f);
+
+                flags[i] = Changed; // children look at this during the same pass
+                ++updated;
+            }
+
+            // Changed is only meaningful within a pass
+            for (uint8_t& flag : flags) flag = 0;
+            anyDirty = false;
+            return updated;
+        }
+
+        size_t size() const { return parents.size(); }
+        int32_t parent(NodeIndex node) const { return parents[node]; }
+        const glm::mat4& local(NodeIndex node) const { return locals[node]; }
+        const glm::mat4& world(NodeIndex node) const { return worlds[node]; }
+        const NormalMatrix& normalMatrix(NodeIndex node) const { return normals[node]; }
+
+    private:
+        enum : uint8_t { Dirty = 1, Changed = 2 };
+
+        std::vector<int32_t> parents;
+        std::vector<glm::mat4> locals;
+        std::vector<glm::mat4> worlds;
+        std::vector<NormalMatrix> normals;
+        std::vector<uint8_t> flags;
+        glm::mat4 rootParent = glm::mat4(1.0f);
+        bool anyDirty = false;
+    };
+}
@@ -0,0 +1,385 @@
+#pragma once
+// GLSL programs: compile/link with error reporting, define-based permutations, and a disk cache of
+// linked program binaries (glGetProgramBinary) so later runs skip the compiler. binaries are keyed by
+// the final sources and the driver string; a driver update simply misses and recompiles.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <filesystem>
+#include <chrono>
+#include <format>
+#include <print>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+#include "UniformBuffers.hpp"
+#include "MeshCache.hpp"
+
+namespace Game {
+#pragma region Compile
+    // name/value pairs turned into #define lines after the #version line
+    using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+    namespace ShaderCompiler {
+        inline std::string withDefines(std::string_view source, const ShaderDefines& defines) {
+            if (defines.empty()) return std::string(source);
+
+            std::string block;
+            for (const auto& [name, value] : defines) block += std::format("#define {} {}\n", name, value);
+
+            // #version has to stay the first statement
+            size_t versionLine = source.find("#version");
+            size_t insertAt = versionLine == std::string_view::npos ? 0 : source.find('\n', versionLine);
+            insertAt = insertAt == std::string_view::npos ? source.size() : insertAt + 1;
+
+            std::string result(source.substr(0, insertAt));
+            if (insertAt == source.size() && !result.empty() && result.back() != '\n') result += '\n';
+            result += block;
+            result += source.substr(insertAt);
+            return result;
+        }
+
+        // 0 and a logged error if the stage doesn't compile
+        inline GLuint compileStage(GLenum type, const std::string& source, std::string_view programName) {
+            GLuint shader = glCreateShader(type);
+            const char* text = source.c_str();
+            glShaderSource(shader, 1, &text, nullptr);
+            glCompileShader(shader);
+
+            GLint success = 0;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                GLint length = 0;
+                glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+                std::string log(std::max(length, 1), '\0');
+                glGetShaderInfoLog(shader, length, nullptr, log.data());
+                std::cerr << "Shader compile error in " << programName << " (" << (type == GL_VERTEX_SHADER ? "VERT" : "FRAG") << "):\n" << log << std::endl;
+                glDeleteShader(shader);
+                return 0;
+            }
+            return shader;
+        }
+
+        inline bool checkLink(GLuint program, std::string_view programName, bool reportErrors = true) {
+            GLint success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success && reportErrors) {
+                GLint length = 0;
+                glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+                std::string log(std::max(length, 1), '\0');
+                glGetProgramInfoLog(program, length, nullptr, log.data());
+                std::cerr << "Program link error in " << programName << ":\n" << log << std::endl;
+            }
+            return success != 0;
+        }
+
+        struct Timings {
+            double compileMs = 0.0, linkMs = 0.0;
+        };
+
+        // compiles and links; 0 if either step fails. retrievable asks the driver to keep a binary around.
+        inline GLuint buildProgram(const std::string& vertexSource, const std::string& fragmentSource, std::string_view programName,
+                                   bool retrievable = false, Timings* timings = nullptr) {
+            using Clock = std::chrono::steady_clock;
+            auto start = Clock::now();
+
+            GLuint vertex = compileStage(GL_VERTEX_SHADER, vertexSource, programName);
+            GLuint fragment = vertex ? compileStage(GL_FRAGMENT_SHADER, fragmentSource, programName) : 0;
+            if (!vertex || !fragment) {
+                if (vertex) glDeleteShader(vertex);
+                return 0;
+            }
+            auto compiled = Clock::now();
+
+            GLuint program = glCreateProgram();
+#ifdef GL_VERSION_4_1
+            if (retrievable && GLAD_GL_VERSION_4_1) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+            glAttachShader(program, vertex);
+            glAttachShader(program, fragment);
+            glLinkProgram(program);
+            glDetachShader(program, vertex);
+            glDetachShader(program, fragment);
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+
+            bool linked = checkLink(program, programName);
+            auto end = Clock::now();
+            if (timings) {
+                timings->compileMs = std::chrono::duration<double, std::milli>(compiled - start).count();
+                timings->linkMs = std::chrono::duration<double, std::milli>(end - compiled).count();
+            }
+            if (!linked) {
+                glDeleteProgram(program);
+                return 0;
+            }
+            return program;
+        }
+    }
+#pragma endregion
+
+#pragma region Shader
+    class Shader {
+    public:
+        GLuint ID = 0;
+
+        // takes over an already linked program
+        explicit Shader(GLuint program) : ID(program) {
+            if (ID) cacheLocations();
+        }
+
+        // compiles on the spot; ID stays 0 (and valid() false) if that fails, the errors are logged
+        Shader(const char* vertexSrc, const char* fragmentSrc)
+            : Shader(ShaderCompiler::buildProgram(vertexSrc, fragmentSrc, "Shader")) {
+        }
+
+        bool valid() const { return ID != 0; }
+
+        void use() const {
+            glState.useProgram(ID);
+        }
+
+        // -1 for names the program doesn't use (or the compiler optimized out), same as glGetUniformLocation
+        GLint location(std::string_view name) const {
+            auto it = uniformLocations.find(name);
+            return it != uniformLocations.end() ? it->second : -1;
+        }
+
+        void setInt(std::string_view name, int value) const {
+            glUniform1i(location(name), value);
+            ++renderCounters.uniformUploads;
+        }
+
+        void setVec3(std::string_view name, const glm::vec3& value) const {
+            glUniform3fv(location(name), 1, &value[0]);
+            ++renderCounters.uniformUploads;
+        }
+
+        void setMat4(std::string_view name, const glm::mat4& mat) const {
+            glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
+            ++renderCounters.uniformUploads;
+        }
+
+    private:
+        struct StringHash {
+            using is_transparent = void;
+            size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+        };
+        std::unordered_map<std::string, GLint, StringHash, std::equal_to<>> uniformLocations;
+
+        // resolve every active uniform once after linking and hook the known uniform blocks up to
+        // their fixed binding points, so nothing has to ask the driver by name during a frame
+        void cacheLocations() {
+            GLint count = 0, maxLength = 0;
+            glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+            glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+            std::string name(std::max(maxLength, 1), '\0');
+            for (GLint i = 0; i < count; ++i) {
+                GLsizei length = 0;
+                GLint size = 0;
+                GLenum type = 0;
+                glGetActiveUniform(ID, i, maxLength, &length, &size, &type, name.data());
+
+                std::string uniformName(name.data(), length);
+                GLint uniformLocation = glGetUniformLocation(ID, uniformName.c_str());
+                if (uniformLocation < 0) continue; // lives in a uniform block
+
+                // arrays are reported as "name[0]", make the plain name resolve too
+                if (uniformName.ends_with("[0]")) {
+                    uniformLocations.emplace(uniformName.substr(0, uniformName.size() - 3), uniformLocation);
+                }
+                uniformLocations.emplace(std::move(uniformName), uniformLocation);
+            }
+
+            bindBlock("Camera", UniformBinding::Camera);
+            bindBlock("Lights", UniformBinding::Lights);
+        }
+
+        void bindBlock(const char* blockName, GLuint binding) {
+            GLuint blockIndex = glGetUniformBlockIndex(ID, blockName);
+            if (blockIndex != GL_INVALID_INDEX) {
+                glUniformBlockBinding(ID, blockIndex, binding);
+            }
+        }
+    };
+#pragma endregion
+
+#pragma region ShaderManager
+    // owns every program permutation; asking twice for the same sources and defines returns the same Shader
+    class ShaderManager {
+    public:
+        bool reportTimings = true; // print a line per program when it is first built
+
+        // binary caching needs GL 4.1 and at least one binary format from the driver; needs a current context
+        explicit ShaderManager(std::filesystem::path cacheDirectory = "shader_cache") : cacheDirectory(std::move(cacheDirectory)) {
+#ifdef GL_VERSION_4_1
+            GLint formats = 0;
+            if (GLAD_GL_VERSION_4_1) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            binaryCache = formats > 0;
+#endif
+            auto glString = [](GLenum name) {
+                const GLubyte* value = glGetString(name);
+                return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+            };
+            std::string driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+            driverHash = MeshCache::hashBytes(driver.data(), driver.size());
+        }
+
+        ShaderManager(const ShaderManager&) = delete;
+        ShaderManager& operator=(const ShaderManager&) = delete;
+
+        ~ShaderManager() {
+            release();
+        }
+
+        // deletes every program; call before the context goes away
+        void release() {
+            for (auto& [key, shader] : programs) {
+                glState.deleteProgram(shader->ID);
+            }
+            programs.clear();
+        }
+
+        // nullptr if the permutation doesn't compile (the log went to stderr)
+        const Shader* program(std::string_view name, std::string_view vertexSource, std::string_view fragmentSource, const ShaderDefines& defines = {}) {
+            std::string vertex = ShaderCompiler::withDefines(vertexSource, defines);
+            std::string fragment = ShaderCompiler::withDefines(fragmentSource, defines);
+            uint64_t sourceHash = MeshCache::hashBytes(vertex.data(), vertex.size(), MeshCache::hashBytes(fragment.data(), fragment.size()));
+
+            auto existing = programs.find(sourceHash);
+            if (existing != programs.end()) return existing->second.get();
+
+            std::string label = permutationName(name, defines);
+            using Clock = std::chrono::steady_clock;
+            auto start = Clock::now();
+
+            GLuint id = loadBinary(sourceHash);
+            if (id) {
+                if (reportTimings) {
+                    std::println("Shader {}: loaded from binary cache in {:.2f} ms", label,
+                        std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+                }
+            }
+            else {
+                ShaderCompiler::Timings timings;
+                id = ShaderCompiler::buildProgram(vertex, fragment, label, binaryCache, &timings);
+                if (!id) return nullptr;
+                if (reportTimings) std::println("Shader {}: compile {:.2f} ms, link {:.2f} ms", label, timings.compileMs, timings.linkMs);
+                storeBinary(id, sourceHash);
+            }
+
+            auto shader = std::make_unique<Shader>(id);
+            const Shader* result = shader.get();
+            programs.emplace(sourceHash, std::move(shader));
+            return result;
+        }
+
+        bool binaryCacheEnabled() const { return binaryCache; }
+
+    private:
+        static constexpr uint32_t kMagic = 0x50474742; // "BGGP"
+        static constexpr uint32_t kVersion = 1;
+
+        struct BinaryHeader {
+            uint32_t magic = kMagic;
+            uint32_t version = kVersion;
+            uint64_t sourceHash = 0;
+            uint64_t driverHash = 0;
+            uint32_t binaryFormat = 0;
+            uint32_t length = 0;
+        };
+
+        static std::string permutationName(std::string_view name, const ShaderDefines& defines) {
+            std::string label(name);
+            for (size_t i = 0; i < defines.size(); ++i) {
+                label += i == 0 ? " [" : ", ";
+                label += defines[i].second.empty() ? defines[i].first : defines[i].first + "=" + defines[i].second;
+            }
+            if (!defines.empty()) label += "]";
+            return label;
+        }
+
+        std::filesystem::path binaryPath(uint64_t sourceHash) const {
+            return cacheDirectory / std::format("{:016x}{:016x}.bgprog", sourceHash, driverHash);
+        }
+
+        // 0 on any mismatch or if the driver rejects the binary
+        GLuint loadBinary(uint64_t sourceHash) {
+#ifdef GL_VERSION_4_1
+            if (!binaryCache) return 0;
+
+            MeshCache::MappedFile file;
+            if (!file.open(binaryPath(sourceHash).string()) || file.size() < sizeof(BinaryHeader)) return 0;
+
+            BinaryHeader header;
+            std::memcpy(&header, file.data(), sizeof(BinaryHeader));
+            if (header.magic != kMagic || header.version != kVersion || header.sourceHash != sourceHash || header.driverHash != driverHash) return 0;
+            if (sizeof(BinaryHeader) + size_t(header.length) > file.size()) return 0;
+
+            GLuint program = glCreateProgram();
+            glProgramBinary(program, header.binaryFormat, file.data() + sizeof(BinaryHeader), static_cast<GLsizei>(header.length));
+            if (!ShaderCompiler::checkLink(program, "binary cache", false)) {
+                glDeleteProgram(program); // stale for this driver after all, rebuild from source
+                return 0;
+            }
+            return program;
+#else
+            (void)sourceHash;
+            return 0;
+#endif
+        }
+
+        void storeBinary(GLuint program, uint64_t sourceHash) {
+#ifdef GL_VERSION_4_1
+            if (!binaryCache) return;
+
+            GLint length = 0;
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (length <= 0) return;
+
+            std::vector<unsigned char> binary(length);
+            BinaryHeader header;
+            header.sourceHash = sourceHash;
+            header.driverHash = driverHash;
+            GLenum format = 0;
+            glGetProgramBinary(program, length, nullptr, &format, binary.data());
+            header.binaryFormat = format;
+            header.length = static_cast<uint32_t>(length);
+
+            std::error_code ec;
+            std::filesystem::create_directories(cacheDirectory, ec);
+            std::filesystem::path path = binaryPath(sourceHash);
+            std::filesystem::path tempPath = path;
+            tempPath += ".tmp";
+
+            // same write-then-rename as the mesh cache
+            FILE* out = std::fopen(tempPath.string().c_str(), "wb");
+            if (!out) return;
+            bool ok = std::fwrite(&header, sizeof(BinaryHeader), 1, out) == 1;
+            ok = ok && std::fwrite(binary.data(), 1, binary.size(), out) == binary.size();
+            ok = (std::fclose(out) == 0) && ok;
+            if (ok) std::filesystem::rename(tempPath, path, ec);
+            if (!ok || ec) {
+                std::filesystem::remove(tempPath, ec);
+                std::cerr << "Failed to write program binary: " << path.string() << std::endl;
+            }
+#else
+            (void)program;
+            (void)sourceHash;
+#endif
+        }
+
+        std::filesystem::path cacheDirectory;
+        uint64_t driverHash = 0;
+        bool binaryCache = false;
+        std::unordered_map<uint64_t, std::unique_ptr<Shader>> programs; // by source hash
+    };
+#pragma endregion
+}
@@ -0,0 +1,231 @@
+#pragma once
+// fixed-timestep simulation on its own thread. every tick advances a SimulationState by exactly one step
+// and publishes it, together with the state before it, through a triple buffer, so neither side ever
+// waits for the other: a vsync stall on the render thread doesn't slow the simulation down, and a slow
+// tick doesn't hold up a frame. the renderer blends the two states of the newest snapshot by how far
+// the wall clock has moved past the tick, which keeps motion smooth at any frame rate, one tick behind.
+// the simulation never touches GL or the TransformStore; the render thread copies the blended
+// transforms into its objects.
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "BaseProperties.hpp"
+
+namespace Game {
+    // single writer, single reader, and neither ever blocks: the writer fills its back slot and swaps it
+    // with the middle one, the reader swaps the middle one with its front slot when something new is in it
+    template<typename T>
+    class TripleBuffer {
+    public:
+        // writer side
+        T& back() { return slots[backIndex]; }
+        void publish() {
+            backIndex = middle.exchange(backIndex | freshBit, std::memory_order_acq_rel) & indexMask;
+        }
+
+        // reader side; true if front() changed
+        bool acquire() {
+            if (!(middle.load(std::memory_order_relaxed) & freshBit)) return false;
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+            return true;
+        }
+        const T& front() const { return slots[frontIndex]; }
+
+    private:
+        static constexpr uint32_t indexMask = 3;
+        static constexpr uint32_t freshBit = 4;
+
+        std::array<T, 3> slots;
+        uint32_t backIndex = 0, frontIndex = 1;
+        std::atomic<uint32_t> middle{ 2 };
+    };
+
+    // what the render thread hands the simulation each frame; the simulation reads the newest one per tick
+    struct SimulationInput {
+        glm::vec3 cameraMove = glm::vec3(0.0f); // world space direction, not normalized (keys add up)
+        glm::vec3 bodyMove = glm::vec3(0.0f);   // for the first body, the model moved from the keyboard
+    };
+
+    struct SimulationState {
+        uint64_t tick = 0;
+        double time = 0.0; // simulated seconds, tick * step
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+        glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+        std::vector<Transform> bodies; // indexed by what addBody returned
+    };
+
+    struct SimulationSnapshot {
+        SimulationState previous, current;
+        double dueSeconds = 0.0; // clock time current was scheduled for, see Simulation::clockSeconds
+    };
+
+    inline Transform interpolate(const Transform& a, const Transform& b, float alpha) {
+        Transform result;
+        result.position = glm::mix(a.position, b.position, alpha);
+        result.rotation = glm::slerp(a.rotation, b.rotation, alpha);
+        result.scale = glm::mix(a.scale, b.scale, alpha);
+        return result;
+    }
+
+    class Simulation {
+    public:
+        // advances state by step seconds; runs on the simulation thread (or in step() without one)
+        using StepFunction = std::function<void(SimulationState& state, const SimulationInput& input, float step)>;
+
+        struct Stats {
+            uint64_t ticks = 0;
+            uint64_t lateTicks = 0;     // started more than a step behind schedule
+            uint64_t droppedTicks = 0;  // skipped after falling too far behind, the simulation slowed down instead
+        };
+
+        // ticks further behind than this are dropped instead of being caught up on, so a long stall
+        // (debugger, window drag) can't snowball into a burst of ticks
+        static constexpr int maxCatchUpTicks = 5;
+
+        Simulation(float stepSeconds, StepFunction stepFunction, SimulationState initial = {})
+            : stepSeconds(stepSeconds), stepFunction(std::move(stepFunction)), state(std::move(initial)), epoch(Clock::now()) {
+            previous = state;
+            // frames before the first tick see the initial state
+            snapshots.back() = { state, state, 0.0 };
+            snapshots.publish();
+        }
+
+        Simulation(const Simulation&) = delete;
+        Simulation& operator=(const Simulation&) = delete;
+
+        ~Simulation() {
+            stop();
+        }
+
+        // ticks at the fixed rate on a thread of its own until stop()
+        void start() {
+            if (thread.joinable()) return;
+            running = true;
+            thread = std::thread([this] { threadLoop(); });
+        }
+
+        void stop() {
+            running = false;
+            if (thread.joinable()) thread.join();
+        }
+
+        // one tick on the calling thread, for runs that must not depend on timing (benchmark mode). not
+        // while the thread runs.
+        void step() {
+            tick(clockSeconds());
+        }
+
+        // any thread; the body joins the state on the next tick, as a copy of transform
+        uint32_t addBody(const Transform& transform) {
+            std::lock_guard<std::mutex> lock(inputMutex);
+            pendingBodies.push_back(transform);
+            return bodyCount++;
+        }
+
+        // render thread, once per frame
+        void setInput(const SimulationInput& input) {
+            std::lock_guard<std::mutex> lock(inputMutex);
+            latestInput = input;
+        }
+
+        // render thread: the newest snapshot; stays the same object until the next call
+        const SimulationSnapshot& latest() {
+            snapshots.acquire();
+            return snapshots.front();
+        }
+
+        // how far to blend from previous to current at clock time now, 0..1
+        float interpolation(const SimulationSnapshot& snapshot, double now) const {
+            return static_cast<float>(std::clamp((now - snapshot.dueSeconds) / stepSeconds, 0.0, 1.0));
+        }
+
+        // seconds since the simulation was created, on the clock ticks are scheduled with
+        double clockSeconds() const {
+            return std::chrono::duration<double>(Clock::now() - epoch).count();
+        }
+
+        float stepSize() const { return stepSeconds; }
+
+        // written by the simulation thread, read without synchronization; only for display
+        Stats stats() const {
+            return { ticks.load(std::memory_order_relaxed), lateTicks.load(std::memory_order_relaxed), droppedTicks.load(std::memory_order_relaxed) };
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        void tick(double dueSeconds) {
+            SimulationInput input;
+            {
+                std::lock_guard<std::mutex> lock(inputMutex);
+                input = latestInput;
+                state.bodies.insert(state.bodies.end(), pendingBodies.begin(), pendingBodies.end());
+                pendingBodies.clear();
+            }
+            // new bodies start out at rest, not sliding in from the origin
+            if (previous.bodies.size() < state.bodies.size()) {
+                previous.bodies.insert(previous.bodies.end(), state.bodies.begin() + previous.bodies.size(), state.bodies.end());
+            }
+
+            stepFunction(state, input, stepSeconds);
+
+            SimulationSnapshot& snapshot = snapshots.back();
+            snapshot.previous = previous; // assignments reuse the slot's storage after the first few ticks
+            snapshot.current = state;
+            snapshot.dueSeconds = dueSeconds;
+            snapshots.publish();
+
+            previous = state;
+            ++state.tick;
+            state.time = double(state.tick) * stepSeconds;
+            ticks.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void threadLoop() {
+            double next = clockSeconds();
+            while (running.load(std::memory_order_relaxed)) {
+                double now = clockSeconds();
+                if (now - next > stepSeconds * maxCatchUpTicks) {
+                    droppedTicks.fetch_add(static_cast<uint64_t>((now - next) / stepSeconds), std::memory_order_relaxed);
+                    next = now;
+                }
+                else if (now - next > stepSeconds) {
+                    lateTicks.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                tick(next);
+                next += stepSeconds;
+
+                // sleep most of the wait, the last millisecond is yielded away since sleeps overshoot
+                double wait = next - clockSeconds();
+                if (wait > 0.002) std::this_thread::sleep_for(std::chrono::duration<double>(wait - 0.001));
+                while (clockSeconds() < next && running.load(std::memory_order_relaxed)) std::this_thread::yield();
+            }
+        }
+
+        float stepSeconds;
+        StepFunction stepFunction;
+        SimulationState state, previous; // simulation thread only
+        TripleBuffer<SimulationSnapshot> snapshots;
+        Clock::time_point epoch;
+
+        std::mutex inputMutex; // guards the three below
+        SimulationInput latestInput;
+        std::vector<Transform> pendingBodies;
+        uint32_t bodyCount = 0;
+
+        std::thread thread;
+        std::atomic<bool> running{ false };
+        std::atomic<uint64_t> ticks{ 0 }, lateTicks{ 0 }, droppedTicks{ 0 };
+    };
+}
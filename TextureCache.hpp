@@ -0,0 +1,433 @@
+#pragma once
+// streamed material textures. TextureCache::load hands out one TextureResource per path right away and
+// decodes the file on worker threads (stb_image) into a box filtered mip chain; opaque images are also
+// compressed to BC1 when the driver has S3TC, and the compressed chain is cached next to the source
+// (".bgtex") so later runs skip decoding and compressing. finished images go to the GPU through a pixel
+// unpack buffer in a bounded step per frame (pumpUploads). a texture draws with a placeholder until it is
+// resident, and again after the cache evicted it to stay inside its memory budget; evicted textures
+// that get drawn again are loaded again.
+
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <print>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "ThreadPool.hpp"
+#include "MeshCache.hpp"
+#include "TextureCompression.hpp"
+#include "GLState.hpp"
+#include "RenderStats.hpp"
+#include "Profiler.hpp"
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0 // EXT_texture_compression_s3tc, everywhere on desktop but never core
+#endif
+
+namespace Game {
+#pragma region TextureResource
+    class TextureResource {
+    public:
+        const std::string path;
+        GLuint id = 0; // what to draw with: the texture itself once resident, the cache's placeholder before that
+        GLsizei width = 0, height = 0;
+
+        // uploaded right away and always resident, for small generated textures
+        TextureResource(std::string path, GLsizei width, GLsizei height, const unsigned char* rgbPixels)
+            : path(std::move(path)), width(width), height(height) {
+            glGenTextures(1, &storage);
+            id = storage;
+            bytes = static_cast<size_t>(width) * height * 3;
+            glState.bindTexture(0, GL_TEXTURE_2D, id);
+
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, rgbPixels);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        // empty, filled in by TextureCache
+        TextureResource(std::string path, GLuint placeholder) : path(std::move(path)), id(placeholder), placeholder(placeholder) {
+        }
+
+        TextureResource(const TextureResource&) = delete;
+        TextureResource& operator=(const TextureResource&) = delete;
+
+        ~TextureResource() {
+            glState.deleteTexture(storage);
+        }
+
+        bool resident() const { return storage != 0; }
+        size_t gpuBytes() const { return bytes; }
+
+        // any thread, from draw submission; the cache doesn't evict textures drawn in the current frame
+        void markUsed() {
+            if (!used.load(std::memory_order_relaxed)) used.store(true, std::memory_order_relaxed);
+        }
+
+    private:
+        friend class TextureCache;
+
+        GLuint storage = 0; // owned texture, 0 while not resident
+        GLuint placeholder = 0;
+        size_t bytes = 0;
+        bool loading = false, failed = false;
+        std::atomic<bool> used{ false };
+        uint64_t lastUsedFrame = 0;
+    };
+#pragma endregion
+
+#pragma region TextureCache
+    struct TextureCacheOptions {
+        bool compress = true;                   // BC1 for opaque images, if the driver has S3TC
+        bool diskCache = true;                  // keep compressed chains next to their sources
+        size_t budgetBytes = size_t(512) << 20; // resident bytes before the least recently drawn textures are dropped
+        bool reportTimings = true;              // print a line per texture once it is uploaded
+    };
+
+    class TextureCache {
+    public:
+        struct Stats {
+            size_t textures = 0, resident = 0, residentBytes = 0;
+            uint64_t uploads = 0, diskHits = 0, evictions = 0;
+        };
+
+        // on the GL thread with the context current; placeholder is drawn in place of textures that aren't resident
+        explicit TextureCache(std::shared_ptr<TextureResource> placeholder, const TextureCacheOptions& options = {},
+                              size_t threadCount = std::min<size_t>(ThreadPool::defaultThreadCount(), 4))
+            : options(options), placeholder(std::move(placeholder)), pool(threadCount) {
+            compressionSupported = hasExtension("GL_EXT_texture_compression_s3tc");
+        }
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        // call before the context goes away, no more loads after it; textures still alive keep their own storage
+        void release() {
+            glState.deleteBuffer(pixelBuffer);
+            pixelBuffer = 0;
+            placeholder.reset();
+        }
+
+        // the one texture for path; starts loading on first request
+        std::shared_ptr<TextureResource> load(const std::string& path) {
+            auto it = entries.find(path);
+            if (it != entries.end()) {
+                if (std::shared_ptr<TextureResource> texture = it->second.lock()) return texture;
+            }
+            auto texture = std::make_shared<TextureResource>(path, placeholder->id);
+            entries[path] = texture;
+            requestDecode(texture);
+            return texture;
+        }
+
+        // GL thread, once per frame; stops once budgetMs of upload work is spent, after at least one texture
+        size_t pumpUploads(double budgetMs = 1.0) {
+            auto start = Clock::now();
+            size_t uploaded = 0;
+            for (;;) {
+                std::unique_ptr<DecodedImage> image;
+                {
+                    std::lock_guard<std::mutex> lock(decodedMutex);
+                    if (decoded.empty()) break;
+                    image = std::move(decoded.front());
+                    decoded.pop_front();
+                }
+                pending.fetch_sub(1, std::memory_order_relaxed);
+
+                std::shared_ptr<TextureResource> texture = image->texture.lock();
+                if (!texture) continue; // dropped while decoding
+                texture->loading = false;
+                if (!image->ok) {
+                    texture->failed = true; // the worker said why; not retried
+                    continue;
+                }
+
+                auto uploadStart = Clock::now();
+                if (!upload(*texture, *image)) continue;
+                ++uploaded;
+                ++currentStats.uploads;
+                if (image->fromDisk) ++currentStats.diskHits;
+
+                if (options.reportTimings) {
+                    std::println("Loaded texture {} ({}, {}x{}, {} levels, {} KB): decode {:.2f} ms, upload {:.2f} ms",
+                        std::filesystem::path(texture->path).filename().string(),
+                        image->fromDisk ? "cache" : image->format == GL_RGBA8 ? "RGBA8" : "BC1", texture->width, texture->height,
+                        image->levels.size(), image->data.size() / 1024, image->decodeMs, msBetween(uploadStart, Clock::now()));
+                }
+                if (msBetween(start, Clock::now()) >= budgetMs) break;
+            }
+            return uploaded;
+        }
+
+        // GL thread, after the frame's draws were submitted. textures drawn since the last call count as
+        // used now, evicted ones among them are loaded again, then the least recently drawn are evicted
+        // until the budget holds. what was drawn this frame is never evicted, so a frame that really
+        // needs more than the budget goes over it.
+        void endFrame() {
+            ++frame;
+            candidates.clear();
+            size_t residentBytes = 0, resident = 0;
+            for (auto it = entries.begin(); it != entries.end();) {
+                std::shared_ptr<TextureResource> texture = it->second.lock();
+                if (!texture) {
+                    it = entries.erase(it);
+                    continue;
+                }
+                ++it;
+
+                if (texture->used.exchange(false, std::memory_order_relaxed)) {
+                    texture->lastUsedFrame = frame;
+                    if (!texture->resident() && !texture->loading && !texture->failed) requestDecode(texture);
+                }
+                if (texture->resident()) {
+                    residentBytes += texture->bytes;
+                    ++resident;
+                    if (texture->lastUsedFrame != frame) candidates.push_back(texture.get()); // kept alive by its owners
+                }
+            }
+
+            if (residentBytes > options.budgetBytes) {
+                std::sort(candidates.begin(), candidates.end(), [](const TextureResource* a, const TextureResource* b) { return a->lastUsedFrame < b->lastUsedFrame; });
+                for (TextureResource* texture : candidates) {
+                    if (residentBytes <= options.budgetBytes) break;
+                    residentBytes -= texture->bytes;
+                    --resident;
+                    evict(*texture);
+                }
+            }
+
+            currentStats.textures = entries.size();
+            currentStats.resident = resident;
+            currentStats.residentBytes = residentBytes;
+        }
+
+        const Stats& stats() const { return currentStats; }
+        bool compressing() const { return options.compress && compressionSupported; }
+        size_t pendingCount() const { return pending.load(std::memory_order_relaxed); }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        using MipLevel = TextureCompression::MipLevel;
+
+        static double msBetween(Clock::time_point a, Clock::time_point b) {
+            return std::chrono::duration<double, std::milli>(b - a).count();
+        }
+
+        // a worker's result, waiting for pumpUploads
+        struct DecodedImage {
+            std::weak_ptr<TextureResource> texture;
+            bool ok = false;
+            bool fromDisk = false;
+            GLenum format = GL_RGBA8; // or GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+            std::vector<uint8_t> data;
+            std::vector<MipLevel> levels;
+            double decodeMs = 0.0;
+        };
+
+#pragma region DiskCache
+        // header, levelCount MipLevels, then the level data the offsets point into
+        struct CacheHeader {
+            uint32_t magic = 0x58544742; // "BGTX"
+            uint32_t version = 1;        // bump when the layout or the encoder output changes
+            uint64_t sourceHash = 0;
+            uint32_t format = 0;
+            uint32_t levelCount = 0;
+        };
+
+        static std::string cachePathFor(const std::string& sourcePath) {
+            return sourcePath + ".bgtex";
+        }
+
+        static bool readCache(const std::string& cachePath, uint64_t sourceHash, DecodedImage& image) {
+            MeshCache::MappedFile file;
+            if (!file.open(cachePath) || file.size() < sizeof(CacheHeader)) return false;
+
+            CacheHeader header;
+            std::memcpy(&header, file.data(), sizeof(CacheHeader));
+            if (header.magic != CacheHeader{}.magic || header.version != CacheHeader{}.version || header.sourceHash != sourceHash) return false;
+            size_t dataStart = sizeof(CacheHeader) + size_t(header.levelCount) * sizeof(MipLevel);
+            if (header.levelCount == 0 || file.size() < dataStart) return false;
+
+            image.levels.resize(header.levelCount);
+            std::memcpy(image.levels.data(), file.data() + sizeof(CacheHeader), header.levelCount * sizeof(MipLevel));
+            const MipLevel& last = image.levels.back();
+            if (last.offset + last.bytes != file.size() - dataStart) {
+                std::cerr << "Texture cache truncated: " << cachePath << std::endl;
+                return false;
+            }
+            image.format = header.format;
+            image.data.assign(file.data() + dataStart, file.data() + file.size());
+            return true;
+        }
+
+        // next to the target and renamed, like the mesh cache, so a crash never leaves a valid-looking file
+        static void writeCache(const std::string& cachePath, uint64_t sourceHash, const DecodedImage& image) {
+            CacheHeader header;
+            header.sourceHash = sourceHash;
+            header.format = image.format;
+            header.levelCount = static_cast<uint32_t>(image.levels.size());
+
+            std::string tempPath = cachePath + ".tmp";
+            FILE* out = std::fopen(tempPath.c_str(), "wb");
+            if (!out) return;
+            bool ok = std::fwrite(&header, sizeof(CacheHeader), 1, out) == 1;
+            ok = ok && std::fwrite(image.levels.data(), sizeof(MipLevel), image.levels.size(), out) == image.levels.size();
+            ok = ok && std::fwrite(image.data.data(), 1, image.data.size(), out) == image.data.size();
+            ok = (std::fclose(out) == 0) && ok;
+
+            std::error_code ec;
+            if (ok) std::filesystem::rename(tempPath, cachePath, ec);
+            if (!ok || ec) {
+                std::filesystem::remove(tempPath, ec);
+                std::cerr << "Failed to write texture cache: " << cachePath << std::endl;
+            }
+        }
+#pragma endregion
+
+        // worker thread
+        static void decodeImage(const std::string& path, bool compress, bool diskCache, DecodedImage& image) {
+            bool useDiskCache = compress && diskCache;
+            uint64_t sourceHash = 0;
+            if (useDiskCache) {
+                if (!MeshCache::hashFile(path, sourceHash)) {
+                    std::cerr << "Failed to open texture: " << path << std::endl;
+                    return;
+                }
+                if (readCache(cachePathFor(path), sourceHash, image)) {
+                    image.ok = image.fromDisk = true;
+                    return;
+                }
+            }
+
+            int width = 0, height = 0, channels = 0;
+            stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+            if (!pixels) {
+                std::cerr << "Failed to decode texture " << path << ": " << stbi_failure_reason() << std::endl;
+                return;
+            }
+            image.data.assign(pixels, pixels + TextureCompression::rgbaSize(width, height));
+            stbi_image_free(pixels);
+            TextureCompression::buildMipChain(image.data, width, height, image.levels);
+
+            if (compress && TextureCompression::isOpaque(image.data.data(), width, height)) {
+                std::vector<uint8_t> blocks;
+                std::vector<MipLevel> blockLevels;
+                TextureCompression::compressChainBC1(image.data, image.levels, blocks, blockLevels);
+                image.data.swap(blocks);
+                image.levels.swap(blockLevels);
+                image.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+                if (useDiskCache) writeCache(cachePathFor(path), sourceHash, image);
+            }
+            image.ok = true;
+        }
+
+        void requestDecode(const std::shared_ptr<TextureResource>& texture) {
+            texture->loading = true;
+            pending.fetch_add(1, std::memory_order_relaxed);
+            std::weak_ptr<TextureResource> weak = texture;
+            pool.enqueue([this, weak, path = texture->path, compress = compressing(), diskCache = options.diskCache] {
+                GAME_PROFILE_ZONE("TextureDecode");
+                auto start = Clock::now();
+                auto image = std::make_unique<DecodedImage>();
+                image->texture = weak;
+                decodeImage(path, compress, diskCache, *image);
+                image->decodeMs = msBetween(start, Clock::now());
+
+                std::lock_guard<std::mutex> lock(decodedMutex);
+                decoded.push_back(std::move(image));
+            });
+        }
+
+        // the whole chain goes through one pixel unpack buffer, orphaned per upload so filling it never
+        // waits on the driver still reading the previous one; the texture is specified from buffer offsets
+        bool upload(TextureResource& texture, const DecodedImage& image) {
+            if (!pixelBuffer) glGenBuffers(1, &pixelBuffer);
+            glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, image.data.size(), nullptr, GL_STREAM_DRAW);
+            void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, image.data.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (!staging) {
+                glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                std::cerr << "Failed to map texture staging buffer for " << texture.path << std::endl;
+                return false;
+            }
+            std::memcpy(staging, image.data.data(), image.data.size());
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            GLuint id = 0;
+            glGenTextures(1, &id);
+            glState.bindTexture(0, GL_TEXTURE_2D, id);
+            for (size_t l = 0; l < image.levels.size(); ++l) {
+                const MipLevel& level = image.levels[l];
+                const void* offset = reinterpret_cast<const void*>(static_cast<uintptr_t>(level.offset));
+                if (image.format == GL_RGBA8) {
+                    glTexImage2D(GL_TEXTURE_2D, GLint(l), GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+                }
+                else {
+                    glCompressedTexImage2D(GL_TEXTURE_2D, GLint(l), image.format, level.width, level.height, 0, GLsizei(level.bytes), offset);
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(image.levels.size() - 1));
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            // any later glTexImage2D with a client pointer would read it as an offset into the buffer
+            glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            ++renderCounters.bufferUploads;
+
+            texture.storage = id;
+            texture.id = id;
+            texture.bytes = image.data.size();
+            texture.width = static_cast<GLsizei>(image.levels[0].width);
+            texture.height = static_cast<GLsizei>(image.levels[0].height);
+            return true;
+        }
+
+        void evict(TextureResource& texture) {
+            glState.deleteTexture(texture.storage);
+            texture.storage = 0;
+            texture.id = texture.placeholder;
+            texture.bytes = 0;
+            ++currentStats.evictions;
+        }
+
+        static bool hasExtension(std::string_view name) {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count; ++i) {
+                const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+                if (extension && name == extension) return true;
+            }
+            return false;
+        }
+
+        TextureCacheOptions options;
+        std::shared_ptr<TextureResource> placeholder;
+        bool compressionSupported = false;
+        std::unordered_map<std::string, std::weak_ptr<TextureResource>> entries;
+        std::vector<TextureResource*> candidates; // eviction scratch
+        uint64_t frame = 0;
+        Stats currentStats;
+        GLuint pixelBuffer = 0;
+
+        std::mutex decodedMutex;
+        std::deque<std::unique_ptr<DecodedImage>> decoded;
+        std::atomic<size_t> pending{ 0 };
+        ThreadPool pool; // declared last so workers are joined before the queue goes away
+    };
+#pragma endregion
+}
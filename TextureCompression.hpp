@@ -0,0 +1,186 @@
+#pragma once
+// CPU side of texture preparation: box filtered mip chains and BC1 (DXT1) block compression. nothing in
+// here touches GL, it runs on the texture decode workers.
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace Game::TextureCompression {
+    struct MipLevel {
+        uint32_t width = 0, height = 0;
+        uint64_t offset = 0, bytes = 0; // into the image data, levels are packed back to back
+    };
+
+    inline size_t rgbaSize(uint32_t width, uint32_t height) { return size_t(width) * height * 4; }
+
+    // BC1 stores 8 bytes per 4x4 block; levels below 4x4 still take a whole block
+    inline size_t bc1Size(uint32_t width, uint32_t height) { return size_t((width + 3) / 4) * ((height + 3) / 4) * 8; }
+
+    inline uint32_t mipCount(uint32_t width, uint32_t height) {
+        uint32_t count = 1;
+        while (width > 1 || height > 1) {
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+            ++count;
+        }
+        return count;
+    }
+
+    inline bool isOpaque(const uint8_t* rgba, uint32_t width, uint32_t height) {
+        for (size_t i = 3; i < rgbaSize(width, height); i += 4) {
+            if (rgba[i] != 255) return false;
+        }
+        return true;
+    }
+
+    // data holds the RGBA8 level 0 on entry and the whole chain down to 1x1 afterwards. each texel of a
+    // level is the average of the 2x2 it covers above, edge texels of odd sizes repeat.
+    inline void buildMipChain(std::vector<uint8_t>& data, uint32_t width, uint32_t height, std::vector<MipLevel>& levels) {
+        levels.clear();
+        levels.reserve(mipCount(width, height));
+        levels.push_back({ width, height, 0, rgbaSize(width, height) });
+        size_t total = rgbaSize(width, height);
+        for (uint32_t w = width, h = height; w > 1 || h > 1;) {
+            w = std::max(w / 2, 1u);
+            h = std::max(h / 2, 1u);
+            levels.push_back({ w, h, total, rgbaSize(w, h) });
+            total += rgbaSize(w, h);
+        }
+        data.resize(total); // once, the loop below keeps pointers into it
+
+        for (size_t l = 1; l < levels.size(); ++l) {
+            const MipLevel& above = levels[l - 1];
+            const MipLevel& level = levels[l];
+            const uint8_t* source = data.data() + above.offset;
+            uint8_t* target = data.data() + level.offset;
+            for (uint32_t y = 0; y < level.height; ++y) {
+                uint32_t y0 = std::min(y * 2, above.height - 1), y1 = std::min(y * 2 + 1, above.height - 1);
+                for (uint32_t x = 0; x < level.width; ++x) {
+                    uint32_t x0 = std::min(x * 2, above.width - 1), x1 = std::min(x * 2 + 1, above.width - 1);
+                    const uint8_t* a = source + (size_t(y0) * above.width + x0) * 4;
+                    const uint8_t* b = source + (size_t(y0) * above.width + x1) * 4;
+                    const uint8_t* c = source + (size_t(y1) * above.width + x0) * 4;
+                    const uint8_t* d = source + (size_t(y1) * above.width + x1) * 4;
+                    uint8_t* out = target + (size_t(y) * level.width + x) * 4;
+                    for (int channel = 0; channel < 4; ++channel) {
+                        out[channel] = static_cast<uint8_t>((a[channel] + b[channel] + c[channel] + d[channel] + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+
+#pragma region BC1
+    inline uint16_t packRgb565(const glm::vec3& color) {
+        glm::vec3 c = glm::clamp(color, 0.0f, 255.0f);
+        uint32_t r = static_cast<uint32_t>(c.x * 31.0f / 255.0f + 0.5f);
+        uint32_t g = static_cast<uint32_t>(c.y * 63.0f / 255.0f + 0.5f);
+        uint32_t b = static_cast<uint32_t>(c.z * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    inline glm::vec3 unpackRgb565(uint16_t packed) {
+        return glm::vec3(float((packed >> 11) & 31) * 255.0f / 31.0f, float((packed >> 5) & 63) * 255.0f / 63.0f, float(packed & 31) * 255.0f / 31.0f);
+    }
+
+    // endpoints at the ends of the colors' main axis (a few power iterations on the covariance), pulled
+    // in by 1/16 of the range since the extremes are rarely worth an exact endpoint; every texel then
+    // takes the nearest of the four palette entries. always the four-color mode, images with alpha stay
+    // uncompressed.
+    inline void compressBlock(const glm::vec3 (&texels)[16], uint8_t* out) {
+        glm::vec3 mean(0.0f);
+        for (const glm::vec3& texel : texels) mean += texel;
+        mean /= 16.0f;
+
+        float xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+        for (const glm::vec3& texel : texels) {
+            glm::vec3 d = texel - mean;
+            xx += d.x * d.x; xy += d.x * d.y; xz += d.x * d.z;
+            yy += d.y * d.y; yz += d.y * d.z; zz += d.z * d.z;
+        }
+        glm::vec3 axis(1.0f, 1.0f, 1.0f);
+        for (int i = 0; i < 4; ++i) {
+            axis = glm::vec3(xx * axis.x + xy * axis.y + xz * axis.z, xy * axis.x + yy * axis.y + yz * axis.z, xz * axis.x + yz * axis.y + zz * axis.z);
+            float length = std::max({ std::abs(axis.x), std::abs(axis.y), std::abs(axis.z) });
+            if (length < 1e-6f) break; // flat block
+            axis /= length;
+        }
+
+        float lo = 0.0f, hi = 0.0f;
+        for (const glm::vec3& texel : texels) {
+            float t = glm::dot(texel - mean, axis);
+            lo = std::min(lo, t);
+            hi = std::max(hi, t);
+        }
+        float inset = (hi - lo) / 16.0f;
+        float axisLength2 = std::max(glm::dot(axis, axis), 1e-6f);
+        uint16_t color0 = packRgb565(mean + axis * ((hi - inset) / axisLength2));
+        uint16_t color1 = packRgb565(mean + axis * ((lo + inset) / axisLength2));
+
+        // four-color mode needs color0 > color1. a block that quantized to one color keeps every index at 0
+        uint32_t indices = 0;
+        if (color0 != color1) {
+            if (color0 < color1) std::swap(color0, color1);
+            glm::vec3 palette[4];
+            palette[0] = unpackRgb565(color0);
+            palette[1] = unpackRgb565(color1);
+            palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+            palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+            for (int i = 0; i < 16; ++i) {
+                uint32_t best = 0;
+                float bestDistance = glm::dot(texels[i] - palette[0], texels[i] - palette[0]);
+                for (uint32_t p = 1; p < 4; ++p) {
+                    float distance = glm::dot(texels[i] - palette[p], texels[i] - palette[p]);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                indices |= best << (i * 2);
+            }
+        }
+
+        std::memcpy(out, &color0, 2);
+        std::memcpy(out + 2, &color1, 2);
+        std::memcpy(out + 4, &indices, 4);
+    }
+
+    // one RGBA8 level to BC1, appended to out; texels past the edge repeat the last row/column
+    inline void compressBC1(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& out) {
+        size_t start = out.size();
+        out.resize(start + bc1Size(width, height));
+        uint8_t* block = out.data() + start;
+        glm::vec3 texels[16];
+        for (uint32_t by = 0; by < height; by += 4) {
+            for (uint32_t bx = 0; bx < width; bx += 4) {
+                for (uint32_t i = 0; i < 16; ++i) {
+                    uint32_t x = std::min(bx + i % 4, width - 1), y = std::min(by + i / 4, height - 1);
+                    const uint8_t* texel = rgba + (size_t(y) * width + x) * 4;
+                    texels[i] = glm::vec3(texel[0], texel[1], texel[2]);
+                }
+                compressBlock(texels, block);
+                block += 8;
+            }
+        }
+    }
+
+    // the whole chain from RGBA8 levels to BC1 levels
+    inline void compressChainBC1(const std::vector<uint8_t>& rgba, const std::vector<MipLevel>& rgbaLevels, std::vector<uint8_t>& out, std::vector<MipLevel>& levels) {
+        out.clear();
+        levels.clear();
+        size_t total = 0;
+        for (const MipLevel& level : rgbaLevels) total += bc1Size(level.width, level.height);
+        out.reserve(total);
+        for (const MipLevel& level : rgbaLevels) {
+            uint64_t offset = out.size();
+            compressBC1(rgba.data() + level.offset, level.width, level.height, out);
+            levels.push_back({ level.width, level.height, offset, out.size() - offset });
+        }
+    }
+#pragma endregion
+}
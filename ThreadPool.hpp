@@ -0,0 +1,72 @@
+#pragma once
+// plain fixed-size worker pool, used for background work like asset decoding
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+namespace Game {
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t threadCount = defaultThreadCount()) {
+            threadCount = std::max<size_t>(threadCount, 1);
+            workers.reserve(threadCount);
+            for (size_t i = 0; i < threadCount; ++i) {
+                workers.emplace_back([this] { workerLoop(); });
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        void enqueue(std::function<void()> task) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push_back(std::move(task));
+            }
+            wake.notify_one();
+        }
+
+        size_t size() const { return workers.size(); }
+
+        // leave one core for the render thread
+        static size_t defaultThreadCount() {
+            unsigned int cores = std::thread::hardware_concurrency();
+            return cores > 1 ? cores - 1 : 1;
+        }
+
+    private:
+        void workerLoop() {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+                    if (stopping && tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+    };
+}
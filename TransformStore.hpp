@@ -0,0 +1,231 @@
+#pragma once
+// structure-of-arrays storage for entity transforms. positions/rotations/scales sit in contiguous
+// per-component arrays with a dirty bit per entity; update() rebuilds only the changed world and
+// normal matrices, four entities at a time with SSE.
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <vector>
+#include <cstdint>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GAME_TRANSFORM_SSE 1
+#include <immintrin.h>
+#endif
+
+#include "BaseProperties.hpp"
+
+namespace Game {
+    // inverse-transpose of the model matrix's upper 3x3, padded to vec4 columns so it can go into
+    // instance buffers as is
+    struct NormalMatrix {
+        glm::vec4 columns[3];
+    };
+
+    class TransformStore {
+    public:
+        using Handle = uint32_t;
+        static constexpr Handle invalidHandle = ~0u;
+
+        Handle create(const Transform& transform = Transform()) {
+            Handle handle;
+            if (!freeHandles.empty()) {
+                handle = freeHandles.back();
+                freeHandles.pop_back();
+            }
+            else {
+                handle = static_cast<Handle>(count++);
+                grow(count);
+            }
+            alive[handle] = 1;
+            set(handle, transform);
+            return handle;
+        }
+
+        void destroy(Handle handle) {
+            alive[handle] = 0;
+            freeHandles.push_back(handle);
+        }
+
+        Transform get(Handle h) const {
+            Transform transform;
+            transform.position = glm::vec3(px[h], py[h], pz[h]);
+            transform.rotation = glm::quat(qw[h], qx[h], qy[h], qz[h]);
+            transform.scale = glm::vec3(sx[h], sy[h], sz[h]);
+            return transform;
+        }
+
+        void set(Handle h, const Transform& transform) {
+            setPosition(h, transform.position);
+            setRotation(h, transform.rotation);
+            setScale(h, transform.scale);
+        }
+
+        glm::vec3 position(Handle h) const { return glm::vec3(px[h], py[h], pz[h]); }
+
+        void setPosition(Handle h, const glm::vec3& p) {
+            px[h] = p.x; py[h] = p.y; pz[h] = p.z;
+            markDirty(h);
+        }
+
+        void translate(Handle h, const glm::vec3& delta) {
+            px[h] += delta.x; py[h] += delta.y; pz[h] += delta.z;
+            markDirty(h);
+        }
+
+        void setRotation(Handle h, const glm::quat& q) {
+            qx[h] = q.x; qy[h] = q.y; qz[h] = q.z; qw[h] = q.w;
+            markDirty(h);
+        }
+
+        void setScale(Handle h, const glm::vec3& s) {
+            sx[h] = s.x; sy[h] = s.y; sz[h] = s.z;
+            markDirty(h);
+        }
+
+        bool isDirty(Handle h) const { return (dirty[h >> 6] >> (h & 63)) & 1; }
+
+        // valid after update()
+        const glm::mat4& worldMatrix(Handle h) const { return world[h]; }
+        const NormalMatrix& normalMatrix(Handle h) const { return normals[h]; }
+
+        // rebuilds world and normal matrices for every dirty entity; returns how many were touched
+        size_t update() { return update(0, dirty.size()); }
+
+        // same, limited to dirty words [firstWord, lastWord) (64 entities per word), so callers can
+        // split the work across threads without sharing a word
+        size_t update(size_t firstWord, size_t lastWord) {
+            size_t updated = 0;
+            for (size_t w = firstWord; w < lastWord; ++w) {
+                uint64_t bits = dirty[w];
+                if (!bits) continue;
+
+                // walk groups of four entities that have at least one dirty member
+                for (uint32_t group = 0; group < 16; ++group) {
+                    if (!((bits >> (group * 4)) & 0xF)) continue;
+                    size_t base = w * 64 + group * 4;
+                    computeGroup(base);
+                    updated += std::popcount((bits >> (group * 4)) & 0xF);
+                }
+                dirty[w] = 0;
+            }
+            return updated;
+        }
+
+        size_t size() const { return count; }
+        size_t dirtyWordCount() const { return dirty.size(); }
+
+    private:
+        void markDirty(Handle h) { dirty[h >> 6] |= uint64_t(1) << (h & 63); }
+
+        void grow(size_t entities) {
+            // pad to a whole dirty word so the SIMD kernel can always read full groups of four
+            size_t padded = (entities + 63) & ~size_t(63);
+            if (padded <= px.size()) return;
+
+            for (std::vector<float>* component : { &px, &py, &pz, &qx, &qy, &qz }) {
+                component->resize(padded, 0.0f);
+            }
+            for (std::vector<float>* component : { &qw, &sx, &sy, &sz }) {
+                component->resize(padded, 1.0f); // identity, so unused lanes stay finite
+            }
+            world.resize(padded, glm::mat4(1.0f));
+            normals.resize(padded, NormalMatrix{ { glm::vec4(1, 0, 0, 0), glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0) } });
+            alive.resize(padded, 0);
+            dirty.resize(padded / 64, 0);
+        }
+
+        // world = T * R * S and normal = R * S^-1 (the inverse-transpose of R * S) for entities base..base+3
+        void computeGroup(size_t base) {
+#ifdef GAME_TRANSFORM_SSE
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 two = _mm_set1_ps(2.0f);
+            const __m128 zero = _mm_setzero_ps();
+
+            __m128 x = _mm_loadu_ps(&qx[base]), y = _mm_loadu_ps(&qy[base]);
+            __m128 z = _mm_loadu_ps(&qz[base]), w = _mm_loadu_ps(&qw[base]);
+
+            __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+            __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+            __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+            // rotation columns, same convention as glm::toMat4
+            __m128 r00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+            __m128 r01 = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+            __m128 r02 = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+            __m128 r10 = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+            __m128 r11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+            __m128 r12 = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+            __m128 r20 = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+            __m128 r21 = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+            __m128 r22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+            __m128 scaleX = _mm_loadu_ps(&sx[base]), scaleY = _mm_loadu_ps(&sy[base]), scaleZ = _mm_loadu_ps(&sz[base]);
+            __m128 invX = _mm_div_ps(one, scaleX), invY = _mm_div_ps(one, scaleY), invZ = _mm_div_ps(one, scaleZ);
+
+            // columns of the four world matrices, still one lane per entity
+            __m128 c0x = _mm_mul_ps(r00, scaleX), c0y = _mm_mul_ps(r01, scaleX), c0z = _mm_mul_ps(r02, scaleX), c0w = zero;
+            __m128 c1x = _mm_mul_ps(r10, scaleY), c1y = _mm_mul_ps(r11, scaleY), c1z = _mm_mul_ps(r12, scaleY), c1w = zero;
+            __m128 c2x = _mm_mul_ps(r20, scaleZ), c2y = _mm_mul_ps(r21, scaleZ), c2z = _mm_mul_ps(r22, scaleZ), c2w = zero;
+            __m128 c3x = _mm_loadu_ps(&px[base]), c3y = _mm_loadu_ps(&py[base]), c3z = _mm_loadu_ps(&pz[base]), c3w = one;
+
+            // transpose lanes into per-entity columns and store
+            _MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+            _MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+            _MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+            _MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+            __m128 worldColumns[4][4] = {
+                { c0x, c1x, c2x, c3x },
+                { c0y, c1y, c2y, c3y },
+                { c0z, c1z, c2z, c3z },
+                { c0w, c1w, c2w, c3w },
+            };
+            for (int e = 0; e < 4; ++e) {
+                float* out = &world[base + e][0][0];
+                for (int c = 0; c < 4; ++c) _mm_storeu_ps(out + c * 4, worldColumns[e][c]);
+            }
+
+            __m128 n0x = _mm_mul_ps(r00, invX), n0y = _mm_mul_ps(r01, invX), n0z = _mm_mul_ps(r02, invX), n0w = zero;
+            __m128 n1x = _mm_mul_ps(r10, invY), n1y = _mm_mul_ps(r11, invY), n1z = _mm_mul_ps(r12, invY), n1w = zero;
+            __m128 n2x = _mm_mul_ps(r20, invZ), n2y = _mm_mul_ps(r21, invZ), n2z = _mm_mul_ps(r22, invZ), n2w = zero;
+            _MM_TRANSPOSE4_PS(n0x, n0y, n0z, n0w);
+            _MM_TRANSPOSE4_PS(n1x, n1y, n1z, n1w);
+            _MM_TRANSPOSE4_PS(n2x, n2y, n2z, n2w);
+            __m128 normalColumns[4][3] = {
+                { n0x, n1x, n2x },
+                { n0y, n1y, n2y },
+                { n0z, n1z, n2z },
+                { n0w, n1w, n2w },
+            };
+            for (int e = 0; e < 4; ++e) {
+                float* out = &normals[base + e].columns[0].x;
+                for (int c = 0; c < 3; ++c) _mm_storeu_ps(out + c * 4, normalColumns[e][c]);
+            }
+#else
+            for (size_t e = base; e < base + 4; ++e) {
+                glm::mat3 rotation = glm::toMat3(glm::quat(qw[e], qx[e], qy[e], qz[e]));
+                glm::vec3 scale(sx[e], sy[e], sz[e]);
+
+                for (int c = 0; c < 3; ++c) {
+                    world[e][c] = glm::vec4(rotation[c] * scale[c], 0.0f);
+                    normals[e].columns[c] = glm::vec4(rotation[c] / scale[c], 0.0f);
+                }
+                world[e][3] = glm::vec4(px[e], py[e], pz[e], 1.0f);
+            }
+#endif
+        }
+
+        size_t count = 0;
+        std::vector<Handle> freeHandles;
+
+        std::vector<float> px, py, pz;      // position
+        std::vector<float> qx, qy, qz, qw;  // rotation
+        std::vector<float> sx, sy, sz;      // scale
+        std::vector<uint8_t> alive;
+        std::vector<uint64_t> dirty;        // one bit per entity
+
+        std::vector<glm::mat4> world;
+        std::vector<NormalMatrix> normals;
+    };
+}
@@ -0,0 +1,135 @@
+#pragma once
+// std140 uniform blocks for frame-constant data. the C++ structs below mirror the GLSL blocks
+// member for member, so keep both sides in sync.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstddef>
+
+#include "RenderStats.hpp"
+#include "GLState.hpp"
+
+namespace Game {
+    // fixed binding points, assigned to the matching blocks when a Shader is linked
+    namespace UniformBinding {
+        constexpr GLuint Camera = 0;
+        constexpr GLuint Lights = 1;
+    }
+
+    constexpr int maxDirLights = 4; // MAX_DIR_LIGHTS in the fragment shader
+
+    // layout(std140) uniform Camera
+    struct CameraBlock {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 viewPos; // xyz used, vec3 would be padded to 16 bytes anyway
+    };
+    static_assert(sizeof(CameraBlock) == 144, "CameraBlock must match std140 layout");
+
+    struct DirectionalLightStd140 {
+        glm::vec4 direction;
+        glm::vec4 color;
+    };
+
+    // layout(std140) uniform Lights
+    struct LightBlock {
+        glm::ivec4 counts;        // x = number of directional lights, y = point and spot lights
+        glm::ivec4 clusterCounts; // froxels along x, y and z, see LightClusters
+        glm::vec4 clusterDepth;   // x, y: depth slice = log(view depth) * x + y
+        glm::vec4 clusterTile;    // xy = tile size in pixels
+        DirectionalLightStd140 dirLights[maxDirLights];
+    };
+    static_assert(sizeof(LightBlock) == 64 + 32 * maxDirLights, "LightBlock must match std140 layout");
+
+    // one uniform block worth of data, rewritten once per frame. the storage is orphaned on every update
+    // so the driver can hand us fresh memory instead of syncing with frames still in flight
+    // (persistent mapping would need GL 4.4, we target 3.3).
+    template<typename Block>
+    class UniformBuffer {
+    public:
+        explicit UniformBuffer(GLuint binding) : binding(binding) {
+            glGenBuffers(1, &id);
+            glState.bindBuffer(GL_UNIFORM_BUFFER, id);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_STREAM_DRAW);
+            glState.bindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+        }
+
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+        ~UniformBuffer() {
+            release();
+        }
+
+        // call before the context goes away
+        void release() {
+            glState.deleteBuffer(id);
+            id = 0;
+        }
+
+        void update(const Block& data) {
+            glState.bindBuffer(GL_UNIFORM_BUFFER, id);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_STREAM_DRAW); // orphan
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &data);
+            ++renderCounters.uniformUploads;
+        }
+
+        GLuint getID() const { return id; }
+        GLuint getBinding() const { return binding; }
+
+    private:
+        GLuint id = 0;
+        GLuint binding;
+    };
+
+    // an array the shader reads through a samplerBuffer, for per-frame data too big for a uniform block.
+    // the texture stays bound to one unit; like UniformBuffer the storage is orphaned on every update.
+    // GL objects are only created by the first update.
+    class TextureBuffer {
+    public:
+        TextureBuffer(GLuint unit, GLenum format) : unit(unit), format(format) {}
+
+        TextureBuffer(const TextureBuffer&) = delete;
+        TextureBuffer& operator=(const TextureBuffer&) = delete;
+
+        ~TextureBuffer() {
+            release();
+        }
+
+        // call before the context goes away
+        void release() {
+            if (texture) glState.deleteTexture(texture);
+            if (buffer) glState.deleteBuffer(buffer);
+            texture = buffer = 0;
+        }
+
+        void update(const void* data, size_t bytes) {
+            bool created = buffer == 0;
+            if (created) {
+                glGenBuffers(1, &buffer);
+                glGenTextures(1, &texture);
+            }
+            glState.bindBuffer(GL_TEXTURE_BUFFER, buffer);
+            // never empty, a texture buffer without storage reads as incomplete on some drivers
+            glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(bytes, 16), nullptr, GL_STREAM_DRAW);
+            if (bytes) glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+            if (created) {
+                bind();
+                glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+            }
+            ++renderCounters.bufferUploads;
+        }
+
+        void bind() const {
+            glState.bindTexture(unit, GL_TEXTURE_BUFFER, texture);
+        }
+
+        GLuint getUnit() const { return unit; }
+
+    private:
+        GLuint unit;
+        GLenum format;
+        GLuint buffer = 0, texture = 0;
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+// compact GPU-side vertex layout. positions are quantized to 16 bits against the mesh bounds (the
+// dequantization rides along in the model matrix), normals go into GL_INT_2_10_10_10_REV and UVs into
+// half floats: 16 bytes instead of Vertex's 32. the vertex shader reads the same vec3/vec3/vec2
+// inputs either way, the attribute setup does the unpacking.
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <limits>
+
+#include "BaseProperties.hpp"
+
+namespace Game {
+    struct PackedVertex {
+        uint16_t position[4]; // unorm16 xyz within the mesh bounds, w unused
+        uint32_t normal;      // snorm 10_10_10_2, w unused
+        uint32_t texCoords;   // two halfs
+    };
+    static_assert(sizeof(PackedVertex) == 16, "PackedVertex is meant to be half of Vertex");
+
+    // maps the unorm16 positions in [0, 1] back into model space: min + p * extent
+    inline glm::mat4 dequantizeMatrix(const AABB& bounds) {
+        glm::mat4 m = glm::translate(glm::mat4(1.0f), bounds.min);
+        return glm::scale(m, bounds.max - bounds.min);
+    }
+
+    // returns the box the positions were quantized against (slightly inflated on flat axes)
+    inline AABB packVertices(std::span<const Vertex> vertices, std::vector<PackedVertex>& out) {
+        AABB bounds = computeBounds(vertices);
+        if (!bounds.valid()) bounds = { glm::vec3(0.0f), glm::vec3(0.0f) };
+        // flat meshes would divide by zero on the flat axis. the padding is relative, a fixed 1e-6 is lost
+        // to rounding once the coordinate is past about 8
+        bounds.max = glm::max(bounds.max, bounds.min + glm::max(glm::vec3(1e-6f), glm::abs(bounds.min) * 1e-6f));
+        glm::vec3 scale = 65535.0f / (bounds.max - bounds.min);
+
+        out.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            const Vertex& v = vertices[i];
+            glm::vec3 q = glm::clamp((v.position - bounds.min) * scale + 0.5f, glm::vec3(0.0f), glm::vec3(65535.0f));
+
+            PackedVertex& p = out[i];
+            p.position[0] = static_cast<uint16_t>(q.x);
+            p.position[1] = static_cast<uint16_t>(q.y);
+            p.position[2] = static_cast<uint16_t>(q.z);
+            p.position[3] = 0;
+            p.normal = glm::packSnorm3x10_1x2(glm::vec4(v.normal, 0.0f));
+            p.texCoords = glm::packHalf2x16(v.texCoords);
+        }
+        return bounds;
+    }
+
+    // 16-bit copy of the indices, or false when some index doesn't fit
+    inline bool narrowIndices(std::span<const unsigned int> indices, size_t vertexCount, std::vector<uint16_t>& out) {
+        if (vertexCount > size_t(std::numeric_limits<uint16_t>::max()) + 1) return false;
+        out.assign(indices.begin(), indices.end());
+        return true;
+    }
+}
@@ -0,0 +1,573 @@
+#pragma region BENCH_HARNESS
+// microbenchmarks for the CPU hot paths; needs no window or GL context. every case reports nanoseconds
+// per operation (median of several samples) and can be written to JSON and compared against a stored
+// baseline, e.g.
+//   BASIC_GAME_BENCH --json bench.json                         record
+//   BASIC_GAME_BENCH --baseline bench.json --threshold 10      fail on anything more than 10% slower
+
+#define GAME_ALLOCATION_COUNTING_IMPLEMENTATION // for allocs/op
+#define STB_IMAGE_IMPLEMENTATION
+#include "main.hpp"
+#include <chrono>
+#include <functional>
+#include <random>
+#include <atomic>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+using namespace Game;
+
+namespace Bench {
+    // keeps the compiler from deleting work whose result is never used
+    template<typename T>
+    inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        static volatile const void* sink;
+        sink = &value;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    struct Result {
+        std::string name;
+        double nsPerOp = 0.0;      // median over the samples
+        double spreadPercent = 0.0; // (slowest - fastest) / median
+        double itemsPerSecond = 0.0;
+        uint64_t iterations = 0;   // per sample
+        double allocationsPerOp = 0.0; // global operator new calls, from any thread
+    };
+
+    struct Case {
+        std::string name;
+        uint64_t itemsPerOp; // what one operation processes (vertices, boxes, ...), for throughput
+        std::function<void(uint64_t iterations)> run;
+    };
+
+    class Runner {
+    public:
+        double minSampleSeconds = 0.05;
+        int samples = 7;
+        std::string filter; // substring of the names to run, empty = all
+
+        void add(std::string name, uint64_t itemsPerOp, std::function<void(uint64_t)> run) {
+            cases.push_back({ std::move(name), itemsPerOp, std::move(run) });
+        }
+
+        std::vector<Result> runAll() const {
+            std::vector<Result> results;
+            std::println("{:<40} {:>12} {:>8} {:>14} {:>10} {:>10}", "benchmark", "ns/op", "spread", "items/s", "iters", "allocs/op");
+            for (const Case& c : cases) {
+                if (!filter.empty() && c.name.find(filter) == std::string::npos) continue;
+                Result result = run(c);
+                std::println("{:<40} {:>12.1f} {:>7.1f}% {:>14.4g} {:>10} {:>10.2f}", result.name, result.nsPerOp, result.spreadPercent, result.itemsPerSecond, result.iterations,
+                    result.allocationsPerOp);
+                results.push_back(std::move(result));
+            }
+            return results;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        static double secondsFor(const Case& c, uint64_t iterations) {
+            auto start = Clock::now();
+            c.run(iterations);
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        Result run(const Case& c) const {
+            // grow the iteration count until one sample takes long enough to time reliably
+            uint64_t iterations = 1;
+            while (secondsFor(c, iterations) < minSampleSeconds && iterations < (uint64_t(1) << 40)) iterations *= 2;
+
+            std::vector<double> nsPerOp;
+            nsPerOp.reserve(samples);
+            uint64_t allocationsBefore = allocationCounters.allocations.load(std::memory_order_relaxed);
+            for (int s = 0; s < samples; ++s) nsPerOp.push_back(secondsFor(c, iterations) * 1e9 / double(iterations));
+            uint64_t allocations = allocationCounters.allocations.load(std::memory_order_relaxed) - allocationsBefore;
+            std::sort(nsPerOp.begin(), nsPerOp.end());
+
+            Result result;
+            result.name = c.name;
+            result.nsPerOp = nsPerOp[nsPerOp.size() / 2];
+            result.spreadPercent = (nsPerOp.back() - nsPerOp.front()) / result.nsPerOp * 100.0;
+            result.itemsPerSecond = double(c.itemsPerOp) * 1e9 / result.nsPerOp;
+            result.iterations = iterations;
+            result.allocationsPerOp = double(allocations) / double(iterations * samples);
+            return result;
+        }
+
+        std::vector<Case> cases;
+    };
+
+    inline bool writeJson(const std::string& path, const std::vector<Result>& results) {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Failed to write benchmark results: " << path << std::endl;
+            return false;
+        }
+#ifdef NDEBUG
+        const char* config = "release";
+#else
+        const char* config = "debug";
+#endif
+        out << std::format("{{\n  \"config\": \"{}\",\n  \"benchmarks\": [\n", config);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out << std::format("    {{\"name\": \"{}\", \"ns_per_op\": {:.3f}, \"spread_percent\": {:.2f}, \"items_per_second\": {:.6g}, \"iterations\": {}, \"allocs_per_op\": {:.3f}}}{}\n",
+                r.name, r.nsPerOp, r.spreadPercent, r.itemsPerSecond, r.iterations, r.allocationsPerOp, i + 1 < results.size() ? "," : "");
+        }
+        out << "  ]\n}\n";
+        return bool(out);
+    }
+
+    // reads back what writeJson wrote: name -> ns_per_op. not a general JSON parser.
+    inline bool readBaseline(const std::string& path, std::map<std::string, double>& nsPerOp) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Failed to open baseline: " << path << std::endl;
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string text = buffer.str();
+
+        const std::string nameKey = "\"name\": \"", timeKey = "\"ns_per_op\": ";
+        for (size_t at = text.find(nameKey); at != std::string::npos; at = text.find(nameKey, at)) {
+            at += nameKey.size();
+            size_t nameEnd = text.find('"', at);
+            size_t time = text.find(timeKey, nameEnd);
+            if (nameEnd == std::string::npos || time == std::string::npos) break;
+            nsPerOp[text.substr(at, nameEnd - at)] = std::strtod(text.c_str() + time + timeKey.size(), nullptr);
+        }
+        return true;
+    }
+
+    // prints current vs baseline, returns how many cases got slower than thresholdPercent
+    inline int compare(const std::vector<Result>& results, const std::map<std::string, double>& baseline, double thresholdPercent) {
+        int regressions = 0;
+        std::println("\n{:<40} {:>12} {:>12} {:>9}", "benchmark", "baseline", "current", "change");
+        for (const Result& r : results) {
+            auto it = baseline.find(r.name);
+            if (it == baseline.end() || it->second <= 0.0) {
+                std::println("{:<40} {:>12} {:>12.1f} {:>9}", r.name, "-", r.nsPerOp, "new");
+                continue;
+            }
+            double change = (r.nsPerOp - it->second) / it->second * 100.0;
+            bool regressed = change > thresholdPercent;
+            regressions += regressed ? 1 : 0;
+            std::println("{:<40} {:>12.1f} {:>12.1f} {:>+8.1f}%{}", r.name, it->second, r.nsPerOp, change, regressed ? "  REGRESSION" : "");
+        }
+        return regressions;
+    }
+}
+#pragma endregion
+
+#pragma region LOADER_BENCHMARKS
+// a size x size vertex grid with normals and uvs, the shape of what Assimp hands over after triangulation
+std::shared_ptr<aiMesh> makeAssimpGrid(unsigned int size) {
+    auto mesh = std::make_shared<aiMesh>();
+    mesh->mNumVertices = size * size;
+    mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+    mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+    mesh->mTextureCoords[0] = new aiVector3D[mesh->mNumVertices];
+    for (unsigned int y = 0; y < size; ++y) {
+        for (unsigned int x = 0; x < size; ++x) {
+            unsigned int i = y * size + x;
+            mesh->mVertices[i] = aiVector3D(float(x), std::sin(x * 0.1f) * std::cos(y * 0.1f), float(y));
+            mesh->mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+            mesh->mTextureCoords[0][i] = aiVector3D(float(x) / size, float(y) / size, 0.0f);
+        }
+    }
+
+    mesh->mNumFaces = (size - 1) * (size - 1) * 2;
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+    unsigned int f = 0;
+    for (unsigned int y = 0; y + 1 < size; ++y) {
+        for (unsigned int x = 0; x + 1 < size; ++x) {
+            unsigned int a = y * size + x, b = a + size;
+            unsigned int corners[2][3] = { { a, b, a + 1 }, { a + 1, b, b + 1 } };
+            for (auto& corner : corners) {
+                aiFace& face = mesh->mFaces[f++];
+                face.mNumIndices = 3;
+                face.mIndices = new unsigned int[3]{ corner[0], corner[1], corner[2] };
+            }
+        }
+    }
+    return mesh;
+}
+
+void registerLoaderBenchmarks(Bench::Runner& runner) {
+    std::shared_ptr<aiMesh> grid = makeAssimpGrid(256);
+    runner.add("loader/assimp_to_vertex_65k", grid->mNumVertices, [grid](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            MeshData data; // fresh every time, allocation is part of a real import
+            appendAssimpMesh(grid.get(), data);
+            Bench::doNotOptimize(data.vertices.data());
+        }
+    });
+
+    auto vertices = std::make_shared<std::vector<Vertex>>();
+    for (unsigned int i = 0; i < grid->mNumVertices; ++i) {
+        vertices->push_back({ glm::vec3(grid->mVertices[i].x, grid->mVertices[i].y, grid->mVertices[i].z), glm::vec3(0, 1, 0), glm::vec2(0.0f) });
+    }
+    runner.add("loader/pack_vertices_65k", vertices->size(), [vertices](uint64_t iterations) {
+        std::vector<PackedVertex> packed;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            AABB bounds = packVertices(*vertices, packed);
+            Bench::doNotOptimize(bounds);
+        }
+    });
+}
+#pragma endregion
+
+#pragma region MATH_BENCHMARKS
+constexpr size_t mathBatch = 4096;
+
+void registerMathBenchmarks(Bench::Runner& runner) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> angle(-3.0f, 3.0f), coordinate(-50.0f, 50.0f);
+
+    auto eulers = std::make_shared<std::vector<glm::vec3>>();
+    auto quats = std::make_shared<std::vector<glm::quat>>();
+    auto points = std::make_shared<std::vector<std::pair<glm::vec3, glm::vec3>>>();
+    for (size_t i = 0; i < mathBatch; ++i) {
+        glm::vec3 euler(angle(rng), angle(rng) * 0.5f, angle(rng));
+        eulers->push_back(euler);
+        quats->push_back(glm::normalize(glm::quat(euler)));
+        points->push_back({ glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng)), glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng)) });
+    }
+
+    runner.add("math/quat_to_euler_4k", mathBatch, [quats](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (const glm::quat& q : *quats) Bench::doNotOptimize(GameObject::ConvertQuatToEuler(q));
+        }
+    });
+    runner.add("math/euler_to_quat_4k", mathBatch, [eulers](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (const glm::vec3& e : *eulers) Bench::doNotOptimize(GameObject::ConvertEulerToQuat(e));
+        }
+    });
+    runner.add("math/look_at_quaternion_4k", mathBatch, [points](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (const auto& [from, to] : *points) Bench::doNotOptimize(lookAtQuaternion(from, to));
+        }
+    });
+
+    // getModelMatrix only reads what TransformStore::update built, so the update is what gets measured
+    auto store = std::make_shared<TransformStore>();
+    auto handles = std::make_shared<std::vector<TransformStore::Handle>>();
+    for (size_t i = 0; i < 16384; ++i) {
+        Transform transform;
+        transform.position = (*points)[i % mathBatch].first;
+        transform.rotation = (*quats)[i % mathBatch];
+        handles->push_back(store->create(transform));
+    }
+    runner.add("math/transform_update_16k", handles->size(), [store, handles](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (TransformStore::Handle h : *handles) store->translate(h, glm::vec3(1e-4f, 0.0f, 0.0f));
+            Bench::doNotOptimize(store->update());
+            Bench::doNotOptimize(store->worldMatrix((*handles)[i % handles->size()]));
+        }
+    });
+}
+#pragma endregion
+
+#pragma region CULLING_BENCHMARKS
+void registerCullingBenchmarks(Bench::Runner& runner) {
+    // camera at the edge of a 128 x 128 field of unit boxes, looking across it
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 6.0f, -4.0f), glm::vec3(30.0f, 0.0f, 40.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    auto frustum = std::make_shared<Frustum>(projection * view);
+
+    auto boxes = std::make_shared<std::vector<AABB>>();
+    for (int z = 0; z < 128; ++z) {
+        for (int x = 0; x < 128; ++x) {
+            glm::vec3 center(x * 1.5f - 32.0f, 0.5f, z * 1.5f - 32.0f);
+            boxes->push_back({ center - glm::vec3(0.5f), center + glm::vec3(0.5f) });
+        }
+    }
+
+    runner.add("culling/frustum_classify_16k", boxes->size(), [frustum, boxes](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            uint32_t visible = 0;
+            for (const AABB& box : *boxes) visible += frustum->intersects(box) ? 1 : 0;
+            Bench::doNotOptimize(visible);
+        }
+    });
+
+    using Tree = BoundingVolumeHierarchy<uint32_t>;
+    auto tree = std::make_shared<Tree>();
+    auto proxies = std::make_shared<std::vector<Tree::ProxyId>>();
+    for (uint32_t i = 0; i < boxes->size(); ++i) proxies->push_back(tree->insert((*boxes)[i], i));
+
+    runner.add("culling/bvh_query_16k", 1, [frustum, tree](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            uint32_t visible = 0;
+            tree->query(*frustum, [&](uint32_t) { ++visible; });
+            Bench::doNotOptimize(visible);
+        }
+    });
+
+    // small back and forth movement, the common case the fat margins are for
+    runner.add("culling/bvh_move_1k", 1024, [tree, proxies, boxes](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            glm::vec3 offset(i % 2 ? 0.02f : -0.02f, 0.0f, 0.0f);
+            for (size_t p = 0; p < 1024; ++p) {
+                const AABB& box = (*boxes)[p * 16];
+                tree->move((*proxies)[p * 16], { box.min + offset, box.max + offset });
+            }
+        }
+    });
+
+    auto sphere = std::make_shared<MeshData>();
+    MeshImportOptions options;
+    options.reportOptimization = false;
+    ProceduralMesh::sphere(*sphere, 1.0f, 64, 128, options);
+    runner.add("culling/meshlet_cull_sphere", sphere->meshlets.size(), [sphere, frustum](uint64_t iterations) {
+        std::vector<LodRange> ranges;
+        Meshlets::CullStats stats;
+        glm::mat4 world = glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 1.0f, 10.0f));
+        for (uint64_t i = 0; i < iterations; ++i) {
+            ranges.clear();
+            Meshlets::cull(sphere->meshlets, world, *frustum, glm::vec3(0.0f, 6.0f, -4.0f), ranges, stats);
+            Bench::doNotOptimize(ranges.data());
+        }
+    });
+}
+#pragma endregion
+
+#pragma region ALLOCATOR_AND_THREADING_BENCHMARKS
+void registerAllocatorBenchmarks(Bench::Runner& runner) {
+    // allocation sizes of a mixed mesh set, freed in a different order than allocated
+    auto sizes = std::make_shared<std::vector<uint32_t>>();
+    auto freeOrder = std::make_shared<std::vector<uint32_t>>();
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> size(24, 4096);
+    for (uint32_t i = 0; i < 1024; ++i) {
+        sizes->push_back(size(rng));
+        freeOrder->push_back(i);
+    }
+    std::shuffle(freeOrder->begin(), freeOrder->end(), rng);
+
+    runner.add("alloc/range_allocator_churn_1k", sizes->size(), [sizes, freeOrder](uint64_t iterations) {
+        RangeAllocator allocator(1u << 23);
+        std::vector<uint32_t> offsets(sizes->size());
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (size_t a = 0; a < sizes->size(); ++a) offsets[a] = allocator.allocate((*sizes)[a]);
+            for (uint32_t a : *freeOrder) allocator.free(offsets[a], (*sizes)[a]);
+        }
+        Bench::doNotOptimize(allocator.largestFree());
+    });
+
+    // what the frame loop's transient lists cost on the heap and in the frame arena
+    runner.add("alloc/vector_heap_1k", 1024, [](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            std::vector<uint32_t> list;
+            for (uint32_t v = 0; v < 1024; ++v) list.push_back(v);
+            Bench::doNotOptimize(list.data());
+        }
+    });
+    auto arena = std::make_shared<FrameArena>();
+    runner.add("alloc/vector_frame_arena_1k", 1024, [arena](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            {
+                std::pmr::vector<uint32_t> list(arena.get());
+                list.reserve(1024);
+                for (uint32_t v = 0; v < 1024; ++v) list.push_back(v);
+                Bench::doNotOptimize(list.data());
+            }
+            arena->reset();
+        }
+    });
+
+    // scene object churn, new/delete against the pool
+    struct Object {
+        glm::mat4 matrix;
+        uint32_t id;
+    };
+    runner.add("alloc/new_delete_1k", 1024, [](uint64_t iterations) {
+        std::vector<Object*> objects(1024);
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (uint32_t o = 0; o < 1024; ++o) objects[o] = new Object{ glm::mat4(1.0f), o };
+            for (Object* object : objects) delete object;
+        }
+    });
+    auto pool = std::make_shared<ObjectPool<Object>>();
+    runner.add("alloc/object_pool_1k", 1024, [pool](uint64_t iterations) {
+        std::vector<Object*> objects(1024);
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (uint32_t o = 0; o < 1024; ++o) objects[o] = pool->create(Object{ glm::mat4(1.0f), o });
+            for (Object* object : objects) pool->destroy(object);
+        }
+    });
+}
+
+void registerThreadingBenchmarks(Bench::Runner& runner) {
+    auto pool = std::make_shared<ThreadPool>(std::min<size_t>(ThreadPool::defaultThreadCount(), 4));
+    runner.add("jobs/thread_pool_enqueue_1k", 1024, [pool](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            std::atomic<uint32_t> done{ 0 };
+            for (int t = 0; t < 1024; ++t) pool->enqueue([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+            while (done.load(std::memory_order_acquire) < 1024) std::this_thread::yield();
+        }
+    });
+
+    // same shape on the job system; the calling thread helps instead of spinning
+    auto jobs = std::make_shared<JobSystem>();
+    runner.add("jobs/job_system_run_1k", 1024, [jobs](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            JobCounter counter;
+            std::atomic<uint32_t> done{ 0 };
+            for (int t = 0; t < 1024; ++t) jobs->run([&done] { done.fetch_add(1, std::memory_order_relaxed); }, &counter);
+            jobs->wait(counter);
+        }
+    });
+
+    // the frame's transform phase, compare with math/transform_update_16k
+    auto store = std::make_shared<TransformStore>();
+    auto handles = std::make_shared<std::vector<TransformStore::Handle>>();
+    for (size_t i = 0; i < 16384; ++i) handles->push_back(store->create(Transform()));
+    runner.add("jobs/parallel_transform_update_16k", handles->size(), [jobs, store, handles](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (TransformStore::Handle h : *handles) store->translate(h, glm::vec3(1e-4f, 0.0f, 0.0f));
+            jobs->parallelFor(static_cast<uint32_t>(store->dirtyWordCount()), 4, [&](uint32_t first, uint32_t last) {
+                store->update(first, last);
+            });
+            Bench::doNotOptimize(store->worldMatrix((*handles)[i % handles->size()]));
+        }
+    });
+
+    runner.add("jobs/profiler_zone_1k", 1024, [](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            for (int z = 0; z < 1024; ++z) {
+                Profiling::ScopedZone zone("BenchZone");
+            }
+        }
+    });
+}
+#pragma endregion
+
+#pragma region LIGHTING_BENCHMARKS
+// 4k point and spot lights over a benchmark-sized field, binned for a camera looking across it
+void registerLightingBenchmarks(Bench::Runner& runner) {
+    auto points = std::make_shared<std::vector<PointLight>>(3584);
+    auto spots = std::make_shared<std::vector<SpotLight>>(512);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coordinate(-40.0f, 40.0f), radius(1.5f, 4.0f);
+    for (PointLight& light : *points) {
+        light.position = glm::vec3(coordinate(rng), 0.5f, coordinate(rng));
+        light.radius = radius(rng);
+    }
+    for (SpotLight& light : *spots) {
+        light.position = glm::vec3(coordinate(rng), 4.0f, coordinate(rng));
+        light.radius = 8.0f;
+    }
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 3.0f, 40.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    uint32_t lightCount = static_cast<uint32_t>(points->size() + spots->size());
+
+    auto serial = std::make_shared<LightClusters>();
+    runner.add("lighting/cluster_build_4k", lightCount, [=](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) serial->build(*points, *spots, view, projection);
+        Bench::doNotOptimize(serial->getStats().references);
+    });
+    auto jobs = std::make_shared<JobSystem>();
+    auto parallel = std::make_shared<LightClusters>();
+    runner.add("lighting/cluster_build_4k_jobs", lightCount, [=](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) parallel->build(*points, *spots, view, projection, jobs.get());
+        Bench::doNotOptimize(parallel->getStats().references);
+    });
+}
+#pragma endregion
+
+#pragma region TEXTURE_BENCHMARKS
+// what a texture decode worker does to a 512x512 image after stb_image
+void registerTextureBenchmarks(Bench::Runner& runner) {
+    const uint32_t size = 512;
+    auto image = std::make_shared<std::vector<uint8_t>>(TextureCompression::rgbaSize(size, size));
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> noise(-12, 12);
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            uint8_t* texel = image->data() + (size_t(y) * size + x) * 4;
+            texel[0] = static_cast<uint8_t>(std::clamp(int(x / 2) + noise(rng), 0, 255));
+            texel[1] = static_cast<uint8_t>(std::clamp(int(y / 2) + noise(rng), 0, 255));
+            texel[2] = static_cast<uint8_t>(std::clamp(int((x ^ y) & 0xff) + noise(rng), 0, 255));
+            texel[3] = 255;
+        }
+    }
+
+    runner.add("texture/mip_chain_512", size * size, [image, size](uint64_t iterations) {
+        std::vector<uint8_t> data;
+        std::vector<TextureCompression::MipLevel> levels;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            data.assign(image->begin(), image->end());
+            TextureCompression::buildMipChain(data, size, size, levels);
+        }
+        Bench::doNotOptimize(data.data());
+    });
+    runner.add("texture/bc1_encode_512", size * size, [image, size](uint64_t iterations) {
+        std::vector<uint8_t> blocks;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            blocks.clear();
+            TextureCompression::compressBC1(image->data(), size, size, blocks);
+        }
+        Bench::doNotOptimize(blocks.data());
+    });
+}
+#pragma endregion
+
+
+int main(int argc, char** argv) {
+    Bench::Runner runner;
+    std::string jsonPath, baselinePath;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--quick") {
+            runner.minSampleSeconds = 0.01;
+            runner.samples = 3;
+        }
+        else if (arg == "--filter" && value) runner.filter = argv[++i];
+        else if (arg == "--json" && value) jsonPath = argv[++i];
+        else if (arg == "--baseline" && value) baselinePath = argv[++i];
+        else if (arg == "--threshold" && value) threshold = std::strtod(argv[++i], nullptr);
+        else {
+            std::println("usage: BASIC_GAME_BENCH [--filter NAME] [--json PATH] [--baseline PATH] [--threshold PERCENT] [--quick]");
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+
+    registerLoaderBenchmarks(runner);
+    registerMathBenchmarks(runner);
+    registerCullingBenchmarks(runner);
+    registerLightingBenchmarks(runner);
+    registerTextureBenchmarks(runner);
+    registerAllocatorBenchmarks(runner);
+    registerThreadingBenchmarks(runner);
+
+    std::vector<Bench::Result> results = runner.runAll();
+    if (!jsonPath.empty() && !Bench::writeJson(jsonPath, results)) return 2;
+
+    if (!baselinePath.empty()) {
+        std::map<std::string, double> baseline;
+        if (!Bench::readBaseline(baselinePath, baseline)) return 2;
+        int regressions = Bench::compare(results, baseline, threshold);
+        if (regressions) {
+            std::println("{} benchmark(s) slower than the baseline by more than {:.1f}%", regressions, threshold);
+            return 1;
+        }
+    }
+    return 0;
+}
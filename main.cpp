@@ -1,8 +1,11 @@
 ﻿#pragma region BASIC_INITIALIZATION
 
+#define GAME_ALLOCATION_COUNTING_IMPLEMENTATION // counts every heap allocation for the frame stats
+#define STB_IMAGE_IMPLEMENTATION // decodes material textures, see TextureCache
 #include "main.hpp"
 #include <unordered_map>
 #include <functional>
+#include <format>
 
 using glm::vec3;
 using std::vector;
@@ -10,15 +13,13 @@ using namespace Game;
 
 int width = 1920, height = 1080;
 
-float lastFrame = 0.0f;
-float deltaTime = 0.0f;
-
 vec3 cameraPos = vec3(0.0f, 0.0f, 3.0f);
 vec3 cameraUp = vec3(0.0f, 1.0f, 0.0f);
 vec3 cameraFront = vec3(0.0f, 0.0f, -1.0f);
 
 glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
 
+ObjectPool<Game::Geometry> geometryPool; // every Geometry comes from here, released with geometryPool.destroy
 vector<Game::Geometry*> geometryObjects;
 
 
@@ -31,24 +32,30 @@ const char* vertexShaderSource = R"(
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoords;
+layout(location = 3) in mat4 model; // per instance, see RenderQueue
+layout(location = 7) in mat3 normalMatrix; // precomputed by TransformStore
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 out float depthVal;
+out float viewDepth; // picks the light cluster slice
 
 void main() {
     vec4 worldPos = model * vec4(aPos, 1.0);
     FragPos = vec3(worldPos);
 
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
     TexCoords = aTexCoords;
 
     vec4 viewSpacePos = view * worldPos;
+    viewDepth = -viewSpacePos.z;
     depthVal = -viewSpacePos.z / 10.0;
     depthVal = clamp(depthVal, 0.0, 1.0);
 
@@ -63,41 +70,75 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 in float depthVal;
+in float viewDepth;
 
 out vec4 FragColor;
 
-uniform vec3 viewPos;
 uniform vec3 objectColor;
 
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
 struct DirectionalLight {
-    vec3 direction;
-    vec3 color;
+    vec4 direction;
+    vec4 color;
+};
+#define MAX_DIR_LIGHTS 4 // maxDirLights on the C++ side
+layout(std140) uniform Lights {
+    ivec4 lightCounts;   // x = directional lights, y = point and spot lights
+    ivec4 clusterCounts; // froxels along x, y and z
+    vec4 clusterDepth;   // slice = log(viewDepth) * x + y
+    vec4 clusterTile;    // xy = tile size in pixels
+    DirectionalLight dirLights[MAX_DIR_LIGHTS];
 };
-#define MAX_DIR_LIGHTS 4
-uniform int numDirLights;
-uniform DirectionalLight dirLights[MAX_DIR_LIGHTS];
+
+// point and spot lights, binned per froxel by LightClusters
+uniform samplerBuffer lightData;      // 3 texels per light: position radius, color spot scale, direction spot offset
+uniform usamplerBuffer lightClusters; // first index and count per froxel
+uniform usamplerBuffer lightIndices;
 
 uniform sampler2D texture1;
 uniform float ambientStrength = 0.1;
 
+vec3 blinnPhong(vec3 lightDir, vec3 color, vec3 norm, vec3 viewDir) {
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 halfway = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(norm, halfway), 0.0), 32.0);
+    return (diff + spec) * color;
+}
+
 void main() {
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
 
     vec3 texColor = texture(texture1, TexCoords).rgb;
 
     vec3 resultColor = vec3(0.0);
-    for (int i = 0; i < numDirLights; ++i) {
-        vec3 lightDir = normalize(-dirLights[i].direction);
-        float diff = max(dot(norm, lightDir), 0.0);
-
-        vec3 halfway = normalize(lightDir + viewDir);
-        float spec = pow(max(dot(norm, halfway), 0.0), 32.0);
-
-        vec3 diffuse = diff * dirLights[i].color;
-        vec3 specular = spec * dirLights[i].color;
+    for (int i = 0; i < lightCounts.x; ++i) {
+        resultColor += blinnPhong(normalize(-dirLights[i].direction.xyz), dirLights[i].color.rgb, norm, viewDir) * texColor;
+    }
 
-        resultColor += (diffuse + specular) * texColor;
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTile.xy), clusterCounts.xy - 1);
+    int slice = clamp(int(log(viewDepth) * clusterDepth.x + clusterDepth.y), 0, clusterCounts.z - 1);
+    uvec2 range = texelFetch(lightClusters, (slice * clusterCounts.y + tile.y) * clusterCounts.x + tile.x).xy;
+    for (uint i = 0u; i < range.y; ++i) {
+        int light = int(texelFetch(lightIndices, int(range.x + i)).r) * 3;
+        vec4 positionRadius = texelFetch(lightData, light);
+        vec4 colorScale = texelFetch(lightData, light + 1);
+        vec4 directionOffset = texelFetch(lightData, light + 2);
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float distance = length(toLight);
+        vec3 lightDir = toLight / max(distance, 1e-4);
+        // inverse square, windowed so it reaches zero at the radius the light was binned with
+        float window = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+        float cone = clamp(dot(-lightDir, directionOffset.xyz) * colorScale.w + directionOffset.w, 0.0, 1.0);
+
+        resultColor += blinnPhong(lightDir, colorScale.rgb * (attenuation * cone * cone), norm, viewDir) * texColor;
     }
 
     resultColor += ambientStrength * texColor;
@@ -121,6 +162,8 @@ void main() {
 
 void framebuffer_size_callback(GLFWwindow* window, int w, int h) {
     glViewport(0, 0, w, h);
+    width = w;
+    height = h; // light cluster tiles are sized from these
     projection = glm::perspective(glm::radians(45.0f), (float)w / (float)h, 0.1f, 100.0f);
 }
 
@@ -168,114 +211,192 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 
 #pragma region KEYBOARD_CONTROLS 
 
-void processInput(GLFWwindow* window) {
-    float cameraSpeed = 2.5f * deltaTime;
-
-    static const std::unordered_map<int, std::function<void()>> actions = {
-        {GLFW_KEY_W, [&]() { cameraPos += cameraSpeed * cameraFront; }},
-        {GLFW_KEY_S, [&]() { cameraPos -= cameraSpeed * cameraFront; }},
-        {GLFW_KEY_A, [&]() { cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed; }},
-        {GLFW_KEY_D, [&]() { cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed; }},
-        {GLFW_KEY_Q, [&]() { cameraPos -= cameraUp * cameraSpeed; }},
-        {GLFW_KEY_E, [&]() { cameraPos += cameraUp * cameraSpeed; }},
-        {GLFW_KEY_ESCAPE, [&]() { glfwSetWindowShouldClose(window, true); }},
+// the direction the keys ask the camera to move in; the simulation applies it at its own rate
+glm::vec3 processInput(GLFWwindow* window) {
+    glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
+    const std::pair<int, glm::vec3> moves[] = {
+        {GLFW_KEY_W, cameraFront},
+        {GLFW_KEY_S, -cameraFront},
+        {GLFW_KEY_A, -right},
+        {GLFW_KEY_D, right},
+        {GLFW_KEY_Q, -cameraUp},
+        {GLFW_KEY_E, cameraUp},
     };
 
-    for (const auto& [key, action] : actions)
+    glm::vec3 direction(0.0f);
+    for (const auto& [key, move] : moves)
         if (glfwGetKey(window, key) == GLFW_PRESS)
-            action();
+            direction += move;
+
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
+    return direction;
 }
 
 
 #define DEBUG
 #ifdef DEBUG
-void processModelInput(GLFWwindow* window,Game::Geometry& model) {
-    float moveSpeed = 2.5f * deltaTime;
-
-    static const std::unordered_map<int, std::function<void()>> actions = {
-        {GLFW_KEY_I, [&]() { model.transform.position += glm::vec3(0.0f, 0.0f, -moveSpeed); }},
-        {GLFW_KEY_K, [&]() { model.transform.position += glm::vec3(0.0f, 0.0f,  moveSpeed); }},
-        {GLFW_KEY_J, [&]() { model.transform.position += glm::vec3(-moveSpeed, 0.0f, 0.0f); }},
-        {GLFW_KEY_L, [&]() { model.transform.position += glm::vec3(moveSpeed, 0.0f, 0.0f); }},
-        {GLFW_KEY_U, [&]() { model.transform.position += glm::vec3(0.0f, -moveSpeed, 0.0f); }},
-        {GLFW_KEY_O, [&]() { model.transform.position += glm::vec3(0.0f,  moveSpeed, 0.0f); }},
+// same for the model, simulation body 0
+glm::vec3 processModelInput(GLFWwindow* window) {
+    static const std::pair<int, glm::vec3> moves[] = {
+        {GLFW_KEY_I, glm::vec3(0.0f, 0.0f, -1.0f)},
+        {GLFW_KEY_K, glm::vec3(0.0f, 0.0f,  1.0f)},
+        {GLFW_KEY_J, glm::vec3(-1.0f, 0.0f, 0.0f)},
+        {GLFW_KEY_L, glm::vec3(1.0f, 0.0f, 0.0f)},
+        {GLFW_KEY_U, glm::vec3(0.0f, -1.0f, 0.0f)},
+        {GLFW_KEY_O, glm::vec3(0.0f,  1.0f, 0.0f)},
     };
 
-    for (const auto& [key, action] : actions)
+    glm::vec3 direction(0.0f);
+    for (const auto& [key, move] : moves)
         if (glfwGetKey(window, key) == GLFW_PRESS)
-            action();
+            direction += move;
+    return direction;
 }
 #endif
 
 #pragma endregion
 
+#pragma region CONTEXT_CREATION
 
-#pragma region SHADER_UTILS
-unsigned int compileShader(unsigned int type, const char* source) {
-    unsigned int shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
-    glCompileShader(shader);
+// 4.3 for multi-draw indirect; everything else only needs 3.3, so settle for that if 4.3 isn't there
+GLFWwindow* createWindowWithContext() {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // --- check compile status
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[1024];
-        glGetShaderInfoLog(shader, 1024, nullptr, infoLog);
-        std::cerr << "Shader compile error (" << (type == GL_VERTEX_SHADER ? "VERT" : "FRAG") << "):\n" << infoLog << std::endl;
+    GLFWwindow* window = glfwCreateWindow(width, height, "Basic Game", nullptr, nullptr);
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(width, height, "Basic Game", nullptr, nullptr);
     }
-    return shader;
+    return window;
 }
 
-unsigned int createShaderProgram() {
-    unsigned int vertex = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    unsigned int fragment = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-    unsigned int program = glCreateProgram();
-    glAttachShader(program, vertex);
-    glAttachShader(program, fragment);
-    glLinkProgram(program);
-
-    // --- check link status
-    GLint success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[1024];
-        glGetProgramInfoLog(program, 1024, nullptr, infoLog);
-        std::cerr << "Program link error:\n" << infoLog << std::endl;
+// the benchmark renders offscreen and never shows the window. without a display (CI, llvmpipe) GLFW's
+// null platform with an OSMesa context does the job, otherwise an invisible window with an EGL context,
+// and as a last resort the platform's usual context API.
+GLFWwindow* createHeadlessContext() {
+#ifdef GLFW_PLATFORM_NULL
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    if (glfwInit()) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        if (GLFWwindow* window = createWindowWithContext()) return window;
+        glfwTerminate();
     }
+    glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+#endif
+    if (!glfwInit()) return nullptr;
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    if (GLFWwindow* window = createWindowWithContext()) return window;
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    return program;
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    return createWindowWithContext();
 }
 
 #pragma endregion
 
+#pragma region BENCHMARK_SCENE
 
-int main() {
-#pragma region GLFW INIT
-    if (!glfwInit()) {
-        std::cerr << "GLFW failed to init.\n";
-        return -1;
+// objects that spin in the benchmark scene, animated from the frame index
+struct Spinner {
+    Game::Geometry* geometry;
+    Game::Transform base;
+    float speed;
+};
+
+// a gridSize x gridSize field of spheres and tori with a few walls between them as occluders, lit by a
+// point light between every four objects and a spot light over every wall. every mesh is generated,
+// nothing is read from disk.
+void buildBenchmarkScene(const Benchmark::Options& options, ResourceRegistry& resources, TransformStore& transforms, vector<Spinner>& spinners, LightManager& lights) {
+    MeshData sphereData, torusData, wallData;
+    ProceduralMesh::sphere(sphereData, 0.8f, 48, 96, resources.importOptions);
+    ProceduralMesh::torus(torusData, 0.8f, 0.3f, 64, 32, resources.importOptions);
+    ProceduralMesh::box(wallData, glm::vec3(0.5f), resources.importOptions);
+
+    std::shared_ptr<MeshResource> sphereMesh = resources.createMesh("<procedural sphere>", sphereData);
+    std::shared_ptr<MeshResource> torusMesh = resources.createMesh("<procedural torus>", torusData);
+    bool keepCpuData = resources.keepCpuData;
+    resources.keepCpuData = true; // occluders are rasterized from the CPU copy
+    std::shared_ptr<MeshResource> wallMesh = resources.createMesh("<procedural wall>", wallData);
+    resources.keepCpuData = keepCpuData;
+    std::shared_ptr<TextureResource> white = resources.defaultWhiteTexture();
+
+    const float spacing = 2.5f;
+    float offset = (options.gridSize - 1) * spacing * 0.5f;
+    for (uint32_t z = 0; z < options.gridSize; ++z) {
+        for (uint32_t x = 0; x < options.gridSize; ++x) {
+            Game::Transform transform;
+            transform.position = vec3(x * spacing - offset, 0.8f, z * spacing - offset);
+            bool torus = (x + z) % 2 == 1;
+            auto* geometry = geometryPool.create(transforms, torus ? torusMesh : sphereMesh, white, transform);
+            geometryObjects.push_back(geometry);
+            if (torus) spinners.push_back({ geometry, transform, 0.5f + 0.1f * float((x * 7 + z * 3) % 5) });
+        }
     }
 
+    // walls every eighth row, with gaps so the camera path sees both sides of them
+    for (uint32_t z = 4; z + 1 < options.gridSize; z += 8) {
+        for (uint32_t x = 0; x + 4 <= options.gridSize; x += 6) {
+            Game::Transform transform;
+            transform.position = vec3((x + 1.5f) * spacing - offset, 1.5f, (z + 0.5f) * spacing - offset);
+            transform.scale = vec3(4.0f * spacing, 3.0f, 0.4f);
+            auto* wall = geometryPool.create(transforms, wallMesh, white, transform);
+            wall->occluder = true;
+            geometryObjects.push_back(wall);
+            lights.addSpotLight(transform.position + vec3(0.0f, 4.0f, 2.0f), vec3(0.0f, -1.0f, -0.3f), vec3(1.0f, 0.9f, 0.7f) * 6.0f,
+                8.0f, glm::radians(25.0f), glm::radians(35.0f));
+        }
+    }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    for (uint32_t z = 0; z + 1 < options.gridSize; z += 2) {
+        for (uint32_t x = 0; x + 1 < options.gridSize; x += 2) {
+            uint32_t hash = (x * 73856093u) ^ (z * 19349663u);
+            vec3 color(float(hash & 0xff), float((hash >> 8) & 0xff), float((hash >> 16) & 0xff));
+            lights.addPointLight(vec3((x + 0.5f) * spacing - offset, 0.3f, (z + 0.5f) * spacing - offset), color / 255.0f * 3.0f, 1.5f * spacing);
+        }
+    }
+}
 
-    GLFWwindow* window = glfwCreateWindow(width, height, "Basic Game", nullptr, nullptr);
+#pragma endregion
+
+
+int main(int argc, char** argv) {
+    Benchmark::Options bench;
+    if (!bench.parse(argc, argv)) return -1;
+
+#pragma region GLFW INIT
+    GLFWwindow* window = nullptr;
+    if (bench.enabled) {
+        width = bench.width;
+        height = bench.height;
+        projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+        window = createHeadlessContext();
+    }
+    else if (glfwInit()) {
+        window = createWindowWithContext();
+    }
+    else {
+        std::cerr << "GLFW failed to init.\n";
+        return -1;
+    }
     if (!window) {
         std::cerr << "Failed to create window\n";
         glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
-	glfwFocusWindow(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSwapInterval(1);
+    if (!bench.enabled) {
+        glfwFocusWindow(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
+    glfwSwapInterval(bench.enabled ? 0 : 1);
 #pragma endregion
 #pragma region GLAD INIT
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -284,11 +405,18 @@ int main() {
     }
 
     // After window setup, set up rendering params and reqs
-    glEnable(GL_DEPTH_TEST);
+    glState.enable(GL_DEPTH_TEST);
+    glState.enable(GL_CULL_FACE); // meshlet cone culling drops the same back faces, keep the two consistent
 #pragma endregion
 
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); //wireframe
 
+    Benchmark::OffscreenTarget offscreen;
+    if (bench.enabled && !offscreen.create(width, height)) {
+        glfwTerminate();
+        return -1;
+    }
+
     LightManager lightManager;
 
     // Add a directional “sun”
@@ -303,65 +431,370 @@ int main() {
     fill.color = glm::vec3(0.3f, 0.4f, 0.5f);
     lightManager.dirLights.push_back(fill);
 
+    // a few local lights around the model; the benchmark scene adds its own
+    if (!bench.enabled) {
+        lightManager.addPointLight(glm::vec3(2.0f, 1.0f, 1.0f), glm::vec3(1.0f, 0.4f, 0.2f) * 4.0f, 6.0f);
+        lightManager.addPointLight(glm::vec3(-2.0f, 0.5f, 1.5f), glm::vec3(0.2f, 0.5f, 1.0f) * 4.0f, 6.0f);
+        lightManager.addSpotLight(glm::vec3(0.0f, 4.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f) * 8.0f, 10.0f, glm::radians(15.0f), glm::radians(25.0f));
+    }
 
-    Game::Geometry* monkey = new Game::Geometry("C:\\Users\\tis\\Documents\\monkey.fbx",
-        Game::Transform(
-            vec3(0.0f),
-
-            glm::quat(glm::radians(
-                vec3(
-                    -90.0f,
-                    0.0f,
-                    0.0f))),
-            
-            vec3(1.0f))
-        );
-	geometryObjects.push_back(monkey);
 
-    Shader shader(vertexShaderSource, fragmentShaderSource);
-    shader.use();
-    shader.setVec3("viewPos", cameraPos);
+    AssetLoader assetLoader;
+    GeometryArena geometryArena; // every indexed mesh lives in here, sharing one VAO per vertex format
+    ResourceRegistry resources; // CPU copies are dropped after upload unless keepCpuData is set
+    resources.arena = &geometryArena;
+    TextureCache textureCache(resources.defaultWhiteTexture()); // material textures, decoded in the background
+    resources.textureCache = &textureCache;
+    TransformStore transforms;
+    Geometry::CullTree cullTree; // every placed Geometry, for frustum culling
+
+    Game::Transform monkeyTransform(
+        vec3(0.0f),
+
+        glm::quat(glm::radians(
+            vec3(
+                -90.0f,
+                0.0f,
+                0.0f))),
+
+        vec3(1.0f));
+
+    // camera movement and everything that animates advance at a fixed rate on the simulation thread; the
+    // loop below only blends the two newest states into what it draws. benchmark mode steps it once per
+    // frame instead, so frame n always shows tick n. bodies are indexed like simulatedBodies.
+    vector<Spinner> spinners;
+    vector<Game::Geometry*> simulatedBodies;
+    Benchmark::CameraPath cameraPath{ bench.gridSize * 1.25f };
+    SimulationState initialState;
+    initialState.cameraPosition = cameraPos;
+    initialState.cameraFront = cameraFront;
+    Simulation::StepFunction stepFunction;
+    if (bench.enabled) {
+        stepFunction = [&spinners, cameraPath](SimulationState& state, const SimulationInput&, float) {
+            float time = float(state.time);
+            state.cameraPosition = cameraPath.position(time);
+            state.cameraFront = cameraPath.front(time);
+            for (size_t i = 0; i < spinners.size(); ++i) {
+                state.bodies[i].rotation = glm::angleAxis(spinners[i].speed * time, glm::vec3(0.0f, 1.0f, 0.0f)) * spinners[i].base.rotation;
+            }
+        };
+    }
+    else {
+        stepFunction = [](SimulationState& state, const SimulationInput& input, float step) {
+            state.cameraPosition += input.cameraMove * (2.5f * step);
+            if (!state.bodies.empty()) state.bodies[0].position += input.bodyMove * (2.5f * step);
+        };
+    }
+    Simulation simulation(bench.enabled ? Benchmark::timeStep : 1.0f / 120.0f, std::move(stepFunction), initialState);
 
+    if (bench.enabled) {
+        buildBenchmarkScene(bench, resources, transforms, spinners, lightManager);
+        for (const Spinner& spinner : spinners) {
+            simulation.addBody(spinner.base);
+            simulatedBodies.push_back(spinner.geometry);
+        }
+    }
+    else {
+        // decoded in the background, the Geometry itself is created by pumpUploads on this thread.
+        // every instance of the same path shares one MeshResource.
+        resources.loadMeshAsync(assetLoader, "C:\\Users\\tis\\Documents\\monkey.fbx", [&resources, &transforms, &simulation, &simulatedBodies, monkeyTransform](std::shared_ptr<MeshResource> mesh) {
+            auto* geometry = geometryPool.create(transforms, mesh, resources.defaultWhiteTexture(), monkeyTransform);
+            geometry->materials = resources.materialTextures(*mesh);
+            geometryObjects.push_back(geometry);
+            simulation.addBody(monkeyTransform);
+            simulatedBodies.push_back(geometry);
+        });
+    }
 
+    RenderQueue renderQueue;
 
-    while (!glfwWindowShouldClose(window)) {
+    // programs are built once per define set; later runs load the linked binaries from shader_cache/
+    ShaderManager shaders;
+    const Shader* shader = shaders.program("lit", vertexShaderSource, fragmentShaderSource);
+    if (!shader) {
+        glfwTerminate();
+        return -1;
+    }
+    shader->use();
+    shader->setInt("texture1", 0); // material texture always lives on unit 0
+    shader->setInt("lightData", LightClusters::lightUnit);
+    shader->setInt("lightClusters", LightClusters::clusterUnit);
+    shader->setInt("lightIndices", LightClusters::indexUnit);
+
+    // frame-constant data, shared by every program through fixed binding points
+    UniformBuffer<CameraBlock> cameraUniforms(UniformBinding::Camera);
+    UniformBuffer<LightBlock> lightUniforms(UniformBinding::Lights);
+    LightClusters lightClusters;
+
+    // frame phases are split across every core through the job system, this thread included; asset
+    // decoding keeps its own ThreadPool so a long decode can't hold up a frame. only GL calls stay here.
+    JobSystem jobs;
+    OcclusionCuller occlusion(&jobs, static_cast<int>(std::min<uint32_t>(jobs.workerCount(), 8)));
+
+    LodSettings lodSettings;
+    ViewCulling viewCulling;
+
+    vector<ViewCulling> cullingChunks; // per submit job chunk, kept across frames for their scratch vectors
+    Geometry::CullTree::CullStats cullStats;
+    float lastTitleUpdate = 0.0f;
+    std::string windowTitle;
+
+    // lists that only live for one frame come from here; the arena is reset when the next frame starts
+    FrameArena frameArena;
+
+    // GPU pass times arrive a couple of frames late; F11 dumps the per-frame log to frame_stats.csv
+    GpuTimer gpuTimer;
+    renderQueue.gpuTimer = &gpuTimer; // one pass per draw batch
+    FrameStatsLog frameStats;
+    bool statsKeyWasDown = false;
+
+    // benchmark mode: warmup frames first, then the measured ones
+    Benchmark::FramePacer framePacer;
+    Benchmark::Recorder benchRecorder;
+    std::vector<uint8_t> benchPixels;
+    uint32_t frameIndex = 0;
+    double benchStart = 0.0;
+
+    if (!bench.enabled) simulation.start();
+
+    while (bench.enabled ? frameIndex < bench.warmupFrames + bench.frames : !glfwWindowShouldClose(window)) {
 #pragma region GLSetup
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        double frameStartTime = glfwGetTime();
+        float currentFrame = bench.enabled ? frameIndex * Benchmark::timeStep : float(frameStartTime);
+        gpuTimer.beginFrame();
+        frameArena.reset();
+        if (bench.enabled && frameIndex == bench.warmupFrames) benchStart = frameStartTime;
+
+        // create GL objects for whatever finished decoding, without blowing the frame
+        {
+            GAME_PROFILE_ZONE("AssetUploads");
+            assetLoader.pumpUploads(2.0);
+            textureCache.pumpUploads(1.0);
+        }
 
-        processInput(window);
-        processModelInput(window, *geometryObjects[0]);
+        if (bench.enabled) {
+            // camera and animation follow the frame index, never the clock
+            GAME_PROFILE_ZONE("Simulation");
+            simulation.step();
+        }
+        else {
+            GAME_PROFILE_ZONE("Input");
+            SimulationInput input;
+            input.cameraMove = processInput(window);
+            input.bodyMove = processModelInput(window);
+            simulation.setInput(input);
+#if GAME_PROFILING
+            if (glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS) Profiling::Profiler::instance().captureTrace(120, "frame_trace.json");
+#endif
+            bool statsKeyDown = glfwGetKey(window, GLFW_KEY_F11) == GLFW_PRESS;
+            if (statsKeyDown && !statsKeyWasDown) frameStats.writeCsv("frame_stats.csv");
+            statsKeyWasDown = statsKeyDown;
+        }
 
-        glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // blend the newest simulation state into the camera and the simulated objects. the mouse still
+        // turns the camera directly, a tick of latency on looking around would be felt.
+        {
+            GAME_PROFILE_ZONE("Interpolation");
+            const SimulationSnapshot& snapshot = simulation.latest();
+            float alpha = bench.enabled ? 1.0f : simulation.interpolation(snapshot, simulation.clockSeconds());
+            cameraPos = glm::mix(snapshot.previous.cameraPosition, snapshot.current.cameraPosition, alpha);
+            if (bench.enabled) cameraFront = snapshot.current.cameraFront;
+            size_t count = std::min({ simulatedBodies.size(), snapshot.previous.bodies.size(), snapshot.current.bodies.size() });
+            for (size_t i = 0; i < count; ++i) {
+                simulatedBodies[i]->setTransform(interpolate(snapshot.previous.bodies[i], snapshot.current.bodies[i], alpha));
+            }
+        }
+
+        // rebuild world/normal matrices of everything that moved, then refit the culling tree for them.
+        // matrices go 64 entities per job word, bounds per object; only the tree update is serial.
+        {
+            GAME_PROFILE_ZONE("TransformUpdate");
+            jobs.parallelFor(static_cast<uint32_t>(transforms.dirtyWordCount()), 4, [&](uint32_t first, uint32_t last) {
+                GAME_PROFILE_ZONE("TransformJob");
+                transforms.update(first, last);
+            });
+            uint32_t objectCount = static_cast<uint32_t>(geometryObjects.size());
+            jobs.parallelFor(objectCount, jobs.grainFor(objectCount, 64), [&](uint32_t first, uint32_t last) {
+                GAME_PROFILE_ZONE("BoundsJob");
+                for (uint32_t i = first; i < last; ++i) geometryObjects[i]->refreshBounds();
+            });
+            for (Game::Geometry* geometry : geometryObjects) {
+                geometry->syncCullTree(cullTree);
+            }
+        }
 
-        shader.use();
+        {
+            GpuTimer::Scope gpuPass(gpuTimer, "Clear");
+            glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
 
-        glm::mat4 model = glm::mat4(1.0f);
         glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 
         // Upload camera uniforms
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
-        shader.setVec3("viewPos", cameraPos);
+        cameraUniforms.update({ view, projection, glm::vec4(cameraPos, 1.0f) });
 
-        // Upload lights
-        lightManager.uploadToShader(shader);
+        // bin point and spot lights into the view's froxels, then upload them with the rest of the lights
+        {
+            GAME_PROFILE_ZONE("LightClustering");
+            lightClusters.build(lightManager.pointLights, lightManager.spotLights, view, projection, &jobs);
+        }
+        {
+            GAME_PROFILE_ZONE("LightUpload");
+            lightClusters.upload();
+            lightClusters.bind();
+            lightManager.upload(lightUniforms, lightClusters, width, height);
+        }
 #pragma endregion
 
-        for (Game::Geometry* geometry : geometryObjects) {
-			geometry->draw(shader.ID);
+        // only what the camera can see goes into the queue (GL is column major, so projection * view)
+        Frustum frustum(projection * view);
+        std::pmr::vector<Game::Geometry*> visibleObjects(&frameArena);
+        std::pmr::vector<Game::Geometry*> occluders(&frameArena);
+        {
+            GAME_PROFILE_ZONE("Culling");
+            viewCulling.frustum = frustum;
+            viewCulling.cameraPosition = cameraPos;
+            viewCulling.meshletStats = {};
+            visibleObjects.reserve(geometryObjects.size());
+            cullTree.query(frustum, [&](Game::Geometry* geometry) { visibleObjects.push_back(geometry); }, &cullStats);
+
+            // then drop whatever hides behind the occluders, nearest occluders first since they cover the most
+            occlusion.beginFrame(projection * view);
+            for (Game::Geometry* geometry : visibleObjects) {
+                if (geometry->occluder) occluders.push_back(geometry);
+            }
+            std::sort(occluders.begin(), occluders.end(), [](const Game::Geometry* a, const Game::Geometry* b) {
+                return glm::dot(a->worldBounds.center() - cameraPos, a->worldBounds.center() - cameraPos) <
+                       glm::dot(b->worldBounds.center() - cameraPos, b->worldBounds.center() - cameraPos);
+            });
+            for (Game::Geometry* geometry : occluders) {
+                geometry->addOccluders(occlusion);
+            }
+            if (occlusion.stats().occluderTriangles) {
+                occlusion.rasterize();
+
+                uint32_t count = static_cast<uint32_t>(visibleObjects.size());
+                uint32_t grain = jobs.grainFor(count, 64);
+                std::span<uint8_t> occlusionVisible = frameArena.allocateArray<uint8_t>(count); // written by the jobs
+                std::span<OcclusionCuller::Stats> occlusionChunks = frameArena.allocateArray<OcclusionCuller::Stats>(JobSystem::chunkCount(count, grain));
+                std::uninitialized_fill(occlusionChunks.begin(), occlusionChunks.end(), OcclusionCuller::Stats{});
+                jobs.parallelFor(count, grain, [&](uint32_t first, uint32_t last) {
+                    GAME_PROFILE_ZONE("OcclusionJob");
+                    OcclusionCuller::Stats& stats = occlusionChunks[first / grain];
+                    for (uint32_t i = first; i < last; ++i) occlusionVisible[i] = occlusion.isVisible(visibleObjects[i]->worldBounds, stats);
+                });
+                for (const OcclusionCuller::Stats& stats : occlusionChunks) occlusion.addStats(stats);
+
+                size_t kept = 0;
+                for (size_t i = 0; i < visibleObjects.size(); ++i) {
+                    if (occlusionVisible[i]) visibleObjects[kept++] = visibleObjects[i];
+                }
+                visibleObjects.resize(kept);
+            }
         }
 
+        {
+            GAME_PROFILE_ZONE("DrawSubmission");
+            // every chunk records into its own list with its own culling scratch; the lists are merged in
+            // chunk order, so the queue sees the same packets in the same order as a serial loop
+            uint32_t count = static_cast<uint32_t>(visibleObjects.size());
+            uint32_t grain = jobs.grainFor(count, 32);
+            uint32_t chunks = JobSystem::chunkCount(count, grain);
+            std::span<DrawList> lists = renderQueue.drawLists(chunks);
+            cullingChunks.resize(chunks);
+            for (ViewCulling& chunk : cullingChunks) {
+                chunk.frustum = viewCulling.frustum;
+                chunk.cameraPosition = viewCulling.cameraPosition;
+                chunk.meshlets = viewCulling.meshlets;
+                chunk.backfaceClusters = viewCulling.backfaceClusters;
+                chunk.meshletStats = {};
+            }
+            jobs.parallelFor(count, grain, [&](uint32_t first, uint32_t last) {
+                GAME_PROFILE_ZONE("SubmitJob");
+                uint32_t chunk = first / grain;
+                for (uint32_t i = first; i < last; ++i) {
+                    visibleObjects[i]->selectLod(lodSettings, cameraPos, projection[1][1]);
+                    visibleObjects[i]->submit(lists[chunk], shader->ID, &cullingChunks[chunk]);
+                }
+            });
+            for (uint32_t chunk = 0; chunk < chunks; ++chunk) viewCulling.meshletStats.add(cullingChunks[chunk].meshletStats);
+
+            renderQueue.flush(); // GPU timed per batch, see RenderQueue::gpuTimer
+        }
+        textureCache.endFrame(); // after the submit jobs marked what they drew
+
+        if (!bench.enabled && currentFrame - lastTitleUpdate > 0.5f) {
+            lastTitleUpdate = currentFrame;
+            // formatted into the same string every time, so once it has its size the title costs no allocation
+            const RenderCounters& counters = renderCounters; // this frame so far, everything but the swap
+            windowTitle.clear();
+            auto out = std::back_inserter(windowTitle);
+            std::format_to(out, "Basic Game | visible {} culled {} (BVH nodes tested {}) | occluded {:.1f}% of {} | meshlet tris rejected {:.1f}% | {} tris | {} draws",
+                cullStats.visible, cullStats.culled, cullStats.nodesTested, occlusion.stats().rejectedPercent(), occlusion.stats().tested,
+                viewCulling.meshletStats.triangleRejectionPercent(), counters.triangles, counters.draws);
+            if (renderQueue.useMultiDrawIndirect) std::format_to(out, " ({} indirect)", renderQueue.stats().indirectCommands);
+            std::format_to(out, " | lights {} visible {} (max {} per cluster) | textures {}/{} resident, {} MB | binds: {} prog {} tex {} vao ({} redundant dropped), {} uniforms | GPU {:.2f} ms (slowest batch {:.3f}) | sim ticks late {} dropped {} | heap allocs {}",
+                lightClusters.getStats().lights, lightClusters.getStats().visibleLights, lightClusters.getStats().maxPerCluster,
+                textureCache.stats().resident, textureCache.stats().textures, textureCache.stats().residentBytes >> 20,
+                counters.programBinds, counters.textureBinds, counters.vaoBinds, counters.redundantCalls, counters.uniformUploads, gpuTimer.totalMs(), gpuTimer.maxMs("Scene batch"),
+                simulation.stats().lateTicks, simulation.stats().droppedTicks, frameStats.lastAllocations().count);
+            glfwSetWindowTitle(window, windowTitle.c_str());
+        }
 
-        glfwSwapBuffers(window);
+        double cpuMs = (glfwGetTime() - frameStartTime) * 1000.0;
+        frameStats.endFrame(cpuMs, &gpuTimer);
+
+        if (bench.enabled) {
+            {
+                GAME_PROFILE_ZONE("FramePacing");
+                framePacer.endFrame();
+            }
+            if (frameIndex >= bench.warmupFrames) {
+                uint32_t measuredFrame = frameIndex - bench.warmupFrames;
+                const RenderCounters& counters = frameStats.lastCounters();
+                benchRecorder.addFrame((glfwGetTime() - frameStartTime) * 1000.0, cpuMs, gpuTimer.hasNewResults() ? gpuTimer.totalMs() : 0.0,
+                    viewCulling.meshletStats.triangleRejectionPercent(), counters.draws, counters.triangles, frameStats.lastAllocations().count);
+
+                // after the frame time is taken, the readback drains the pipeline
+                if (bench.hashEvery && measuredFrame % bench.hashEvery == 0) {
+                    offscreen.readPixels(benchPixels);
+                    benchRecorder.addHash(measuredFrame, Benchmark::hashPixels(benchPixels));
+                }
+            }
+            ++frameIndex;
+        }
+        else {
+            GAME_PROFILE_ZONE("SwapBuffers");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
+        GAME_PROFILE_FRAME();
+    }
+
+#if GAME_PROFILING
+    Profiling::Profiler::instance().printReport();
+#endif
+    if (bench.enabled) {
+        benchRecorder.printReport(bench, glfwGetTime() - benchStart);
+        if (!bench.csvPath.empty()) frameStats.writeCsv(bench.csvPath);
     }
 
+    simulation.stop();
     for (Game::Geometry* geometry : geometryObjects) {
-        delete geometry;
+        geometryPool.destroy(geometry);
 	}
+    geometryObjects.clear();
+    renderQueue.release();
+    gpuTimer.release();
+    geometryArena.release();
+    shaders.release();
+    cameraUniforms.release();
+    lightUniforms.release();
+    lightClusters.release();
+    textureCache.release();
+    framePacer.release();
+    offscreen.release();
     glfwTerminate();
     return 0;
 }
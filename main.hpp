@@ -11,12 +11,32 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/quaternion.hpp>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 #include <iostream>
 #include <cmath>
 #include <print>
+#include <string_view>
+#include <unordered_map>
+
+#include "BaseProperties.hpp"
+#include "UniformBuffers.hpp"
+#include "MeshLoader.hpp"
+#include "AssetLoader.hpp"
+#include "Resources.hpp"
+#include "RenderQueue.hpp"
+#include "TransformStore.hpp"
+#include "SceneGraph.hpp"
+#include "Bounds.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+#include "OcclusionCuller.hpp"
+#include "Meshlets.hpp"
+#include "ShaderManager.hpp"
+#include "JobSystem.hpp"
+#include "LightClusters.hpp"
+#include "Simulation.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "ProceduralMesh.hpp"
+#include "Benchmark.hpp"
 
 using glm::vec3;
 using std::vector;
@@ -31,66 +51,14 @@ namespace Game{
         glm::mat3 rotMat(right, newUp, forward); // columns = right, up, forward
         return glm::quat_cast(rotMat);
     }
-
-    class Shader {
-    public:
-        GLuint ID;
-
-        Shader(const char* vertexSrc, const char* fragmentSrc) {
-            // compile shaders, link program, store ID
-            // error handling omitted for brevity
-            GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
-            glShaderSource(vertex, 1, &vertexSrc, nullptr);
-            glCompileShader(vertex);
-
-            GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
-            glShaderSource(fragment, 1, &fragmentSrc, nullptr);
-            glCompileShader(fragment);
-
-            ID = glCreateProgram();
-            glAttachShader(ID, vertex);
-            glAttachShader(ID, fragment);
-            glLinkProgram(ID);
-
-            glDeleteShader(vertex);
-            glDeleteShader(fragment);
-        }
-
-        void use() const {
-            glUseProgram(ID);
-        }
-
-        void setInt(const std::string& name, int value) const {
-            glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
-        }
-
-        void setVec3(const std::string& name, const glm::vec3& value) const {
-            glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
-        }
-
-        void setMat4(const std::string& name, const glm::mat4& mat) const {
-            glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
-        }
-    };
-#pragma endregion
-
-#pragma region BaseProperties
-	struct Transform {
-        glm::vec3 position = glm::vec3(0.0f);
-        glm::quat rotation = glm::quat(glm::vec3(0.0f)); // from Euler or direct quaternion
-        glm::vec3 scale = glm::vec3(1.0f);
-	};
-	struct Vertex {
-		glm::vec3 position;
-		glm::vec3 normal;
-		glm::vec2 texCoords;
-	};
 #pragma endregion
 
 #pragma region EngineObjects
     class GameObject {
 	public:
-		Transform transform; // Transform for position, rotation, and scale
+        // position, rotation and scale live in the TransformStore, the object only keeps its slot
+        TransformStore* transforms = nullptr;
+        TransformStore::Handle transformHandle = TransformStore::invalidHandle;
 
 		static glm::vec3 ConvertQuatToEuler(const glm::quat& q) {
             // Convert quaternion to Euler angles (in radians)
@@ -116,165 +84,202 @@ namespace Game{
         }
 
         GameObject() = default;
-        GameObject(const Transform& transform) : transform(transform) {
+        GameObject(TransformStore& store, const Transform& transform) : transforms(&store), transformHandle(store.create(transform)) {
+        }
+        GameObject(const GameObject&) = delete;
+        GameObject& operator=(const GameObject&) = delete;
+        virtual ~GameObject() {
+            if (transforms) transforms->destroy(transformHandle);
         }
-        virtual ~GameObject() {}
+
+        Transform getTransform() const { return transforms->get(transformHandle); }
+        void setTransform(const Transform& transform) { transforms->set(transformHandle, transform); }
+        void translate(const glm::vec3& delta) { transforms->translate(transformHandle, delta); }
 
 	private:
 
 	};
 
+    // when to switch to coarser LOD levels. sizes are the projected bounding sphere diameter as a fraction
+    // of the viewport height; level i + 1 is used below screenSizes[i].
+    struct LodSettings {
+        float screenSizes[maxLodLevels - 1] = { 0.3f, 0.15f, 0.075f };
+        float hysteresis = 0.15f; // fraction a size has to move past a threshold before the level changes back
+    };
+
+    // per-view state for culling below the object level: parts against the frustum, meshlets against the
+    // frustum and the camera position. back-facing clusters are only dropped when faces are culled anyway.
+    struct ViewCulling {
+        Frustum frustum;
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+        bool meshlets = true;
+        bool backfaceClusters = true;
+        Meshlets::CullStats meshletStats; // accumulates, reset by the owner once per frame
+        std::vector<LodRange> visibleRanges; // scratch
+    };
+
+    // a placed instance of a shared mesh; the GPU data lives in MeshResource and is shared by every
+    // Geometry made from the same file
     class Geometry : public Game::GameObject {
     public:
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
+        using CullTree = BoundingVolumeHierarchy<Geometry*>;
 
-        GLuint vao = 0, vbo = 0, ebo = 0;
-        GLuint textureID = 0; 
+        std::shared_ptr<MeshResource> mesh;
+        std::shared_ptr<TextureResource> texture; // for sub-meshes whose material has no texture of its own
+        std::vector<std::shared_ptr<TextureResource>> materials; // by SubMesh::materialIndex, see ResourceRegistry::materialTextures
+        SceneGraph parts; // the model's node hierarchy, hanging off this object's transform
+        AABB worldBounds;  // valid after updateBounds
+        bool occluder = false; // rasterized into the occlusion buffer; needs the mesh's CPU data (keepCpuData)
+        uint32_t lodLevel = 0;  // picked by selectLod, sub-meshes clamp it to the levels they have
 
 
         Geometry() {
         }
 
-        Geometry(const std::string& path) {
-            createDefaultWhiteTexture(); // debug
-
-            Assimp::Importer importer; // initalize model importer and process model
-            const aiScene* scene = importer.ReadFile(path,
-                aiProcess_Triangulate |
-                aiProcess_GenNormals |
-                aiProcess_FlipUVs |
-                aiProcess_JoinIdenticalVertices);
-
-            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-                std::cerr << "Assimp Error: " << importer.GetErrorString() << std::endl;
-                return;
-            }
-
-            for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
-                size_t vertexOffset = vertices.size(); // number of vertices already in the vector
-
-                for (unsigned int i = 0; i < scene->mMeshes[m]->mNumVertices; ++i) {
-                    glm::vec3 pos(scene->mMeshes[m]->mVertices[i].x, scene->mMeshes[m]->mVertices[i].y, scene->mMeshes[m]->mVertices[i].z);
-                    glm::vec3 norm(scene->mMeshes[m]->mNormals[i].x, scene->mMeshes[m]->mNormals[i].y, scene->mMeshes[m]->mNormals[i].z);
-
-                    glm::vec2 uv(0.0f, 0.0f);
-                    if (scene->mMeshes[m]->mTextureCoords[0]) {
-                        uv = glm::vec2(scene->mMeshes[m]->mTextureCoords[0][i].x, scene->mMeshes[m]->mTextureCoords[0][i].y);
-                    }
-
-                    vertices.push_back({ pos, norm, uv });
-                }
-
-                for (unsigned int i = 0; i < scene->mMeshes[m]->mNumFaces; ++i) {
-                    aiFace face = scene->mMeshes[m]->mFaces[i];
-                    for (unsigned int j = 0; j < face.mNumIndices; ++j) {
-                        indices.push_back(face.mIndices[j] + vertexOffset);
-                    }
-                }
-            }
-            if (!indices.empty()) {
-                glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-            }
-            else {
-                glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-            }
-
-            upload();
+        Geometry(TransformStore& transforms, std::shared_ptr<MeshResource> mesh, std::shared_ptr<TextureResource> texture, const Transform& initTransform)
+            : GameObject(transforms, initTransform), mesh(std::move(mesh)), texture(std::move(texture)) {
+            if (this->mesh) parts = SceneGraph(this->mesh->nodes);
         }
 
-        Geometry(const std::string& path, const Transform& initTransform) : Geometry(path) {transform = initTransform;}
-
+        Geometry(TransformStore& transforms, ResourceRegistry& resources, const std::string& path, const Transform& initTransform = Transform())
+            : Geometry(transforms, resources.loadMesh(path), resources.defaultWhiteTexture(), initTransform) {
+            if (mesh) materials = resources.materialTextures(*mesh);
+        }
 
         virtual ~Geometry() {
-            if (ebo) glDeleteBuffers(1, &ebo);
-            if (vbo) glDeleteBuffers(1, &vbo);
-            if (vao) glDeleteVertexArrays(1, &vao);
-
-
+            if (cullTree) cullTree->remove(cullProxy);
         }
 
 
-        glm::mat4 getModelMatrix() const {
-            glm::mat4 model = glm::mat4(1.0f);
-
-            model = glm::translate(model, transform.position);
-
-            // Rotation
-            model *= glm::toMat4(transform.rotation);
-
-
-            model = glm::scale(model, transform.scale);
-
-            return model;
+        // built in bulk by TransformStore::update, valid once that ran this frame
+        const glm::mat4& getModelMatrix() const {
+            return transforms->worldMatrix(transformHandle);
         }
 
-        void upload() {
-            glGenVertexArrays(1, &vao);
-            glGenBuffers(1, &vbo);
-            glBindVertexArray(vao);
-
-            glBindBuffer(GL_ARRAY_BUFFER, vbo);
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-            if (!indices.empty()) {
-                glGenBuffers(1, &ebo);
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-            }
-
-            // --- Vertex attributes ---
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0); // position
-            glEnableVertexAttribArray(0);
-
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal)); // normal
-            glEnableVertexAttribArray(1);
-
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords)); // uv
-            glEnableVertexAttribArray(2);
-
-            glBindVertexArray(0);
+        const NormalMatrix& getNormalMatrix() const {
+            return transforms->normalMatrix(transformHandle);
         }
 
 
-        void draw(GLuint shaderProgram) {
-            glUseProgram(shaderProgram);
-
-            glm::mat4 model = getModelMatrix();
-
-            GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        // brings the node transforms and world bounds up to date and registers/refits this object in
+        // the culling tree. cheap for objects that didn't move. call after TransformStore::update.
+        void updateBounds(CullTree& tree) {
+            refreshBounds();
+            syncCullTree(tree);
+        }
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0); // shader uniform
+        // the half of updateBounds that only touches this object, so it can run for many objects in
+        // parallel. true if the bounds changed.
+        bool refreshBounds() {
+            if (!mesh || !transforms) return false;
+
+            parts.setParentTransform(getModelMatrix());
+            bool moved = parts.update() > 0;
+            if (!moved && cullTree) return false;
+
+            worldBounds = AABB();
+            forEachSubMesh([this](SceneGraph::NodeIndex node, const SubMesh& subMesh) {
+                worldBounds.expand(subMesh.bounds.transformed(parts.world(node)));
+            });
+            boundsChanged = true;
+            return true;
+        }
 
-            glBindVertexArray(vao);
+        // the other half: hands bounds changed by refreshBounds to the tree, one thread at a time
+        void syncCullTree(CullTree& tree) {
+            if (!boundsChanged) return;
+            boundsChanged = false;
 
-            if (!indices.empty()) {
-                glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+            if (!cullTree) {
+                cullTree = &tree;
+                cullProxy = tree.insert(worldBounds, this);
             }
             else {
-                // vertices.size() is the number of `vec3` vertices
-                glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+                tree.move(cullProxy, worldBounds);
             }
-
-            glBindVertexArray(0);
         }
 
-    private:
-        void createDefaultWhiteTexture() {
-            glGenTextures(1, &textureID);
-            glBindTexture(GL_TEXTURE_2D, textureID);
+        // picks the LOD level from the on-screen size of worldBounds. projectionScale is projection[1][1]
+        // (cot of half the vertical fov). returns the level.
+        uint32_t selectLod(const LodSettings& settings, const glm::vec3& cameraPosition, float projectionScale) {
+            float radius = glm::length(worldBounds.extents());
+            float distance = std::max(glm::length(worldBounds.center() - cameraPosition) - radius, 1e-3f);
+            float screenSize = radius * projectionScale / distance;
+
+            // move one level per frame and only once the size is clearly past the threshold, so objects
+            // sitting right at a boundary don't flicker between levels; a camera cut settles over a few frames
+            if (lodLevel + 1 < maxLodLevels && screenSize < settings.screenSizes[lodLevel] * (1.0f - settings.hysteresis)) ++lodLevel;
+            else if (lodLevel > 0 && screenSize > settings.screenSizes[lodLevel - 1] * (1.0f + settings.hysteresis)) --lodLevel;
+            return lodLevel;
+        }
 
-            unsigned char whitePixel[3] = { 255, 255, 255 }; // RGB
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, whitePixel);
+        // queues every sub-mesh of this instance at its node's world transform; the actual draws
+        // happen batched in RenderQueue::flush. with culling, models made of several parts also drop
+        // the parts that are off screen, and full resolution sub-meshes only draw their visible meshlets.
+        // only writes to this object, queue and culling, so jobs with their own list and ViewCulling can
+        // submit different objects at the same time.
+        void submit(DrawList& queue, GLuint shaderProgram, ViewCulling* culling = nullptr) {
+            if (!mesh || !transforms) return;
+
+            parts.setParentTransform(getModelMatrix());
+            parts.update();
+
+            GLuint fallbackTexture = texture ? texture->id : 0;
+            auto textureFor = [&](const SubMesh& subMesh) {
+                TextureResource* material = subMesh.materialIndex < materials.size() ? materials[subMesh.materialIndex].get() : nullptr;
+                if (!material) return fallbackTexture;
+                material->markUsed();
+                return material->id;
+            };
+            bool testParts = culling && mesh->subMeshes.size() > 1;
+            bool testMeshlets = culling && culling->meshlets && lodLevel == 0 && mesh->indexCount;
+            forEachSubMesh([&](SceneGraph::NodeIndex node, const SubMesh& subMesh) {
+                if (testParts && !culling->frustum.intersects(subMesh.bounds.transformed(parts.world(node)))) return;
+
+                // instances drawn this way can't share a draw, so single-cluster sub-meshes aren't worth it
+                if (testMeshlets && subMesh.meshletCount > 1) {
+                    culling->visibleRanges.clear();
+                    std::span<const Meshlet> meshlets = std::span<const Meshlet>(mesh->meshlets).subspan(subMesh.firstMeshlet, subMesh.meshletCount);
+                    if (Meshlets::cull(meshlets, parts.world(node), culling->frustum, culling->cameraPosition, culling->visibleRanges,
+                                       culling->meshletStats, culling->backfaceClusters)) {
+                        queue.submitClusters(shaderProgram, *mesh, subMesh, textureFor(subMesh), parts.world(node), parts.normalMatrix(node), culling->visibleRanges);
+                    }
+                    return;
+                }
+                queue.submit(shaderProgram, *mesh, subMesh, textureFor(subMesh), parts.world(node), parts.normalMatrix(node), lodLevel);
+            });
+        }
 
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glBindTexture(GL_TEXTURE_2D, 0);
+        // feeds this object's triangles to the software occlusion rasterizer, false if it has no CPU
+        // copy of its mesh or the culler's triangle budget ran out
+        bool addOccluders(OcclusionCuller& culler) const {
+            if (!mesh || mesh->vertices.empty() || mesh->indices.empty()) return false;
+
+            bool added = true;
+            std::span<const Vertex> vertices = mesh->vertices;
+            std::span<const unsigned int> indices = mesh->indices;
+            forEachSubMesh([&](SceneGraph::NodeIndex node, const SubMesh& subMesh) {
+                if (!added) return;
+                added = culler.addOccluder(vertices.subspan(subMesh.vertexOffset, subMesh.vertexCount),
+                    indices.subspan(subMesh.indexOffset, subMesh.indexCount), subMesh.vertexOffset, parts.world(node));
+            });
+            return added;
         }
 
+    private:
+        CullTree* cullTree = nullptr;
+        CullTree::ProxyId cullProxy = CullTree::nullNode;
+        bool boundsChanged = false; // set by refreshBounds, cleared by syncCullTree
+
+        template<typename Callback>
+        void forEachSubMesh(Callback&& callback) const {
+            for (SceneGraph::NodeIndex node = 0; node < parts.size(); ++node) {
+                const MeshNode& meshNode = mesh->nodes[node];
+                for (uint32_t i = 0; i < meshNode.meshCount; ++i) {
+                    callback(node, mesh->subMeshes[mesh->nodeMeshes[meshNode.firstMesh + i]]);
+                }
+            }
+        }
     };
 
 #pragma region Lights
@@ -283,28 +288,44 @@ namespace Game{
         vec3 color;
     };
 
+    // directional lights go straight into the Lights block and light every fragment; point and spot lights
+    // are binned into froxels by LightClusters first, so any number of them can be in the scene
     class LightManager {
     public:
         std::vector<DirectionalLight> dirLights;
+        std::vector<PointLight> pointLights;
+        std::vector<SpotLight> spotLights;
 
         void addDirectionalLight(const glm::vec3& direction, const glm::vec3& color) {
             dirLights.push_back({ direction, color });
         }
 
+        void addPointLight(const glm::vec3& position, const glm::vec3& color, float radius) {
+            pointLights.push_back({ position, color, radius });
+        }
+
+        void addSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float radius, float innerAngle, float outerAngle) {
+            spotLights.push_back({ position, glm::normalize(direction), color, radius, innerAngle, outerAngle });
+        }
+
         void pointLightAtTarget(size_t index, const glm::vec3& from, const glm::vec3& target) {
             if (index >= dirLights.size()) return;
             glm::quat q = lookAtQuaternion(from, target);
             dirLights[index].direction = glm::rotate(q, glm::vec3(0, 0, -1));
         }
 
-        void uploadToShader(Shader& shader) {
-            shader.use();
-            shader.setInt("numDirLights", static_cast<int>(dirLights.size()));
-            for (size_t i = 0; i < dirLights.size(); ++i) {
-                std::string base = "dirLights[" + std::to_string(i) + "]";
-                shader.setVec3(base + ".direction", dirLights[i].direction);
-                shader.setVec3(base + ".color", dirLights[i].color);
+        // writes the directional lights and the cluster grid layout into the Lights uniform block, once per
+        // frame after clusters were built from pointLights and spotLights
+        void upload(UniformBuffer<LightBlock>& buffer, const LightClusters& clusters, int viewportWidth, int viewportHeight) const {
+            LightBlock block{};
+            int count = static_cast<int>(std::min<size_t>(dirLights.size(), maxDirLights));
+            block.counts = glm::ivec4(count, 0, 0, 0);
+            clusters.fillBlock(block, viewportWidth, viewportHeight);
+            for (int i = 0; i < count; ++i) {
+                block.dirLights[i].direction = glm::vec4(dirLights[i].direction, 0.0f);
+                block.dirLights[i].color = glm::vec4(dirLights[i].color, 0.0f);
             }
+            buffer.update(block);
         }
     };
 #pragma endregion